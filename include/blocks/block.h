@@ -3,6 +3,7 @@
 #include "blocks/block_visitor.h"
 #include "util/tracer.h"
 #include <assert.h>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <unordered_map>
@@ -15,18 +16,89 @@ class builder_context;
 namespace block {
 class block;
 
-template <typename T>
-bool isa(std::shared_ptr<block> p) {
-	std::shared_ptr<T> ret = std::dynamic_pointer_cast<T>(p);
-	if (ret != nullptr)
-		return true;
-	return false;
+// Kinds of the blocks, every class is followed by the classes derived from 
+// it, so that the kinds of a class and its subclasses are a range. Classes 
+// derived from the blocks elsewhere keep the kind of their base, and define 
+// classof with a dynamic_cast like foreign_expr
+enum class block_kind {
+	block,
+	expr,
+	unary_expr,
+	not_expr,
+	unary_minus_expr,
+	bitwise_not_expr,
+	addr_of_expr,
+	cast_expr,
+	binary_expr,
+	and_expr,
+	bitwise_and_expr,
+	or_expr,
+	bitwise_or_expr,
+	bitwise_xor_expr,
+	plus_expr,
+	minus_expr,
+	mul_expr,
+	div_expr,
+	lt_expr,
+	gt_expr,
+	lte_expr,
+	gte_expr,
+	lshift_expr,
+	rshift_expr,
+	equals_expr,
+	ne_expr,
+	mod_expr,
+	var_expr,
+	const_expr,
+	int_const,
+	double_const,
+	float_const,
+	string_const,
+	assign_expr,
+	sq_bkt_expr,
+	function_call_expr,
+	initializer_list_expr,
+	foreign_expr_base,
+	member_access_expr,
+	stmt,
+	expr_stmt,
+	stmt_block,
+	decl_stmt,
+	if_stmt,
+	case_stmt,
+	switch_stmt,
+	label_stmt,
+	goto_stmt,
+	while_stmt,
+	for_stmt,
+	break_stmt,
+	continue_stmt,
+	func_decl,
+	struct_decl,
+	return_stmt,
+	label,
+	type,
+	scalar_type,
+	pointer_type,
+	reference_type,
+	function_type,
+	array_type,
+	builder_var_type,
+	named_type,
+	anonymous_type,
+	var
+};
+
+// Type tests compare the kind the block was created with instead of 
+// walking the RTTI, and don't copy the pointer
+template <typename T, typename U>
+bool isa(const std::shared_ptr<U> &p) {
+	return p != nullptr && T::classof(p.get());
 }
-template <typename T>
-std::shared_ptr<T> to(std::shared_ptr<block> p) {
-	std::shared_ptr<T> ret = std::dynamic_pointer_cast<T>(p);
-	assert(ret != nullptr);
-	return ret;
+template <typename T, typename U>
+std::shared_ptr<T> to(const std::shared_ptr<U> &p) {
+	assert(isa<T>(p));
+	return std::static_pointer_cast<T>(p);
 }
 
 template <typename T>
@@ -83,11 +155,21 @@ public:
 	virtual ~block() = default;
 
 	typedef std::shared_ptr<block> Ptr;
+	static bool classof(const block *) {
+		return true;
+	}
+
+	block_kind kind = block_kind::block;
 
 	tracer::tag static_offset;
 
 	std::unordered_map<std::string, std::shared_ptr<block_metadata>> metadata_map;
 
+	// Forked process the block was created in. The fork based extraction 
+	// uses this to find the blocks that existed before the process was forked
+	uint64_t fork_epoch = current_fork_epoch;
+	static uint64_t current_fork_epoch;
+
 	template <typename T>
 	void setMetadata(std::string mdname, const T &val) {
 		typename block_metadata_impl<T>::Ptr mdnode = std::make_shared<block_metadata_impl<T>>(val);
@@ -0,0 +1,83 @@
+#ifndef BLOCK_SERIALIZER_H
+#define BLOCK_SERIALIZER_H
+#include "blocks/stmt.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace block {
+
+// Writes blocks into a buffer that the process the writing process was 
+// forked from can read back. Blocks created before the fork (fork_epoch 
+// below shared_epoch) are at the same address in both processes and are 
+// written as pointers, so that the reader gets the very same objects. All 
+// the other blocks are written fully, keeping the sharing between them.
+// Static var snapshots in tags are copied as bytes. If something can't be
+// written (foreign exprs, metadata of unknown types, snapshots of types that
+// aren't trivially copyable) failed is set and the buffer shouldn't be used.
+class block_writer {
+	std::string buffer;
+	uint64_t shared_epoch;
+	std::unordered_map<block *, uint64_t> written_ids;
+
+	void write_fields(int kind, block::Ptr b);
+	// Metadata of unknown types fails the write unless skipped
+	void write_metadata(block::Ptr b, bool skip_unknown);
+
+public:
+	bool failed = false;
+
+	block_writer(uint64_t shared_epoch) : shared_epoch(shared_epoch) {}
+
+	void write_u64(uint64_t v);
+	void write_bytes(const void *p, size_t size);
+	void write_string(const std::string &s);
+	void write_tag(const tracer::tag &t);
+	void write_block(block::Ptr b);
+
+	const std::string &get_buffer(void) {
+		return buffer;
+	}
+};
+
+class block_reader {
+	const std::string &buffer;
+	size_t offset = 0;
+	std::vector<block::Ptr> read_blocks;
+
+	void read_fields(int kind, block::Ptr b);
+	void read_metadata(block::Ptr b);
+
+public:
+	// Set if the buffer ended early or has unknown contents
+	bool failed = false;
+	// Call stacks of the tags read are interned here if set
+	tracer::call_stack_trie *trie = nullptr;
+
+	block_reader(const std::string &buffer) : buffer(buffer) {}
+
+	uint64_t read_u64(void);
+	void read_bytes(void *p, size_t size);
+	std::string read_string(void);
+	tracer::tag read_tag(void);
+	block::Ptr read_block(void);
+
+	template <typename T>
+	std::shared_ptr<T> read_block_as(void) {
+		block::Ptr b = read_block();
+		if (b == nullptr)
+			return nullptr;
+		std::shared_ptr<T> ret = std::dynamic_pointer_cast<T>(b);
+		if (ret == nullptr)
+			failed = true;
+		return ret;
+	}
+
+	bool at_end(void) {
+		return offset == buffer.size();
+	}
+};
+
+} // namespace block
+#endif
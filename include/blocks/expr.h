@@ -10,6 +10,12 @@ namespace block {
 class expr : public block {
 public:
 	typedef std::shared_ptr<expr> Ptr;
+	expr() {
+		kind = block_kind::expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind >= block_kind::expr && b->kind <= block_kind::member_access_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<expr>());
@@ -46,6 +52,12 @@ bool binary_is_same(std::shared_ptr<T> first, block::Ptr second) {
 class unary_expr : public expr {
 public:
 	typedef std::shared_ptr<unary_expr> Ptr;
+	unary_expr() {
+		kind = block_kind::unary_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind >= block_kind::unary_expr && b->kind <= block_kind::cast_expr;
+	}
 	expr::Ptr expr1;
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
@@ -59,6 +71,12 @@ public:
 class binary_expr : public expr {
 public:
 	typedef std::shared_ptr<binary_expr> Ptr;
+	binary_expr() {
+		kind = block_kind::binary_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind >= block_kind::binary_expr && b->kind <= block_kind::mod_expr;
+	}
 
 	virtual void dump(std::ostream &, int) override;
 	expr::Ptr expr1;
@@ -91,6 +109,12 @@ std::shared_ptr<T> binary_clone_helper(T* t) {
 class not_expr : public unary_expr {
 public:
 	typedef std::shared_ptr<not_expr> Ptr;
+	not_expr() {
+		kind = block_kind::not_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::not_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<not_expr>());
@@ -106,6 +130,12 @@ public:
 class unary_minus_expr : public unary_expr {
 public:
 	typedef std::shared_ptr<unary_minus_expr> Ptr;
+	unary_minus_expr() {
+		kind = block_kind::unary_minus_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::unary_minus_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<unary_minus_expr>());
@@ -121,6 +151,12 @@ public:
 class bitwise_not_expr : public unary_expr {
 public:
 	typedef std::shared_ptr<bitwise_not_expr> Ptr;
+	bitwise_not_expr() {
+		kind = block_kind::bitwise_not_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::bitwise_not_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<bitwise_not_expr>());
@@ -136,6 +172,12 @@ public:
 class and_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<and_expr> Ptr;
+	and_expr() {
+		kind = block_kind::and_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::and_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<and_expr>());
@@ -151,6 +193,12 @@ public:
 class bitwise_and_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<bitwise_and_expr> Ptr;
+	bitwise_and_expr() {
+		kind = block_kind::bitwise_and_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::bitwise_and_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<bitwise_and_expr>());
@@ -166,6 +214,12 @@ public:
 class or_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<or_expr> Ptr;
+	or_expr() {
+		kind = block_kind::or_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::or_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<or_expr>());
@@ -181,6 +235,12 @@ public:
 class bitwise_or_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<bitwise_or_expr> Ptr;
+	bitwise_or_expr() {
+		kind = block_kind::bitwise_or_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::bitwise_or_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<bitwise_or_expr>());
@@ -196,6 +256,12 @@ public:
 class bitwise_xor_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<bitwise_xor_expr> Ptr;
+	bitwise_xor_expr() {
+		kind = block_kind::bitwise_xor_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::bitwise_xor_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<bitwise_xor_expr>());
@@ -211,6 +277,12 @@ public:
 class plus_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<plus_expr> Ptr;
+	plus_expr() {
+		kind = block_kind::plus_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::plus_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<plus_expr>());
@@ -226,6 +298,12 @@ public:
 class minus_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<minus_expr> Ptr;
+	minus_expr() {
+		kind = block_kind::minus_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::minus_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<minus_expr>());
@@ -241,6 +319,12 @@ public:
 class mul_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<mul_expr> Ptr;
+	mul_expr() {
+		kind = block_kind::mul_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::mul_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<mul_expr>());
@@ -256,6 +340,12 @@ public:
 class div_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<div_expr> Ptr;
+	div_expr() {
+		kind = block_kind::div_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::div_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<div_expr>());
@@ -270,6 +360,12 @@ public:
 class lt_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<lt_expr> Ptr;
+	lt_expr() {
+		kind = block_kind::lt_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::lt_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<lt_expr>());
@@ -284,6 +380,12 @@ public:
 class gt_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<gt_expr> Ptr;
+	gt_expr() {
+		kind = block_kind::gt_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::gt_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<gt_expr>());
@@ -298,6 +400,12 @@ public:
 class lte_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<lte_expr> Ptr;
+	lte_expr() {
+		kind = block_kind::lte_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::lte_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<lte_expr>());
@@ -312,6 +420,12 @@ public:
 class gte_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<gte_expr> Ptr;
+	gte_expr() {
+		kind = block_kind::gte_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::gte_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<gte_expr>());
@@ -326,6 +440,12 @@ public:
 class lshift_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<lshift_expr> Ptr;
+	lshift_expr() {
+		kind = block_kind::lshift_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::lshift_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<lshift_expr>());
@@ -340,6 +460,12 @@ public:
 class rshift_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<rshift_expr> Ptr;
+	rshift_expr() {
+		kind = block_kind::rshift_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::rshift_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<rshift_expr>());
@@ -354,6 +480,12 @@ public:
 class equals_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<equals_expr> Ptr;
+	equals_expr() {
+		kind = block_kind::equals_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::equals_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<equals_expr>());
@@ -369,6 +501,12 @@ public:
 class ne_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<ne_expr> Ptr;
+	ne_expr() {
+		kind = block_kind::ne_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::ne_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<ne_expr>());
@@ -384,6 +522,12 @@ public:
 class mod_expr : public binary_expr {
 public:
 	typedef std::shared_ptr<mod_expr> Ptr;
+	mod_expr() {
+		kind = block_kind::mod_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::mod_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<mod_expr>());
@@ -398,6 +542,12 @@ public:
 class var_expr : public expr {
 public:
 	typedef std::shared_ptr<var_expr> Ptr;
+	var_expr() {
+		kind = block_kind::var_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::var_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<var_expr>());
@@ -434,6 +584,12 @@ public:
 class const_expr : public expr {
 public:
 	typedef std::shared_ptr<const_expr> Ptr;
+	const_expr() {
+		kind = block_kind::const_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind >= block_kind::const_expr && b->kind <= block_kind::string_const;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<const_expr>());
@@ -449,6 +605,12 @@ public:
 class int_const : public const_expr {
 public:
 	typedef std::shared_ptr<int_const> Ptr;
+	int_const() {
+		kind = block_kind::int_const;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::int_const;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<int_const>());
@@ -475,6 +637,12 @@ public:
 class double_const : public const_expr {
 public:
 	typedef std::shared_ptr<double_const> Ptr;
+	double_const() {
+		kind = block_kind::double_const;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::double_const;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<double_const>());
@@ -500,6 +668,12 @@ public:
 class float_const : public const_expr {
 public:
 	typedef std::shared_ptr<float_const> Ptr;
+	float_const() {
+		kind = block_kind::float_const;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::float_const;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<float_const>());
@@ -525,6 +699,12 @@ public:
 class string_const : public const_expr {
 public:
 	typedef std::shared_ptr<string_const> Ptr;
+	string_const() {
+		kind = block_kind::string_const;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::string_const;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<string_const>());
@@ -550,6 +730,12 @@ public:
 class assign_expr : public expr {
 public:
 	typedef std::shared_ptr<assign_expr> Ptr;
+	assign_expr() {
+		kind = block_kind::assign_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::assign_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<assign_expr>());
@@ -578,6 +764,12 @@ public:
 class sq_bkt_expr : public expr {
 public:
 	typedef std::shared_ptr<sq_bkt_expr> Ptr;
+	sq_bkt_expr() {
+		kind = block_kind::sq_bkt_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::sq_bkt_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<sq_bkt_expr>());
@@ -605,6 +797,12 @@ public:
 class function_call_expr : public expr {
 public:
 	typedef std::shared_ptr<function_call_expr> Ptr;
+	function_call_expr() {
+		kind = block_kind::function_call_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::function_call_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<function_call_expr>());
@@ -640,6 +838,12 @@ public:
 class initializer_list_expr : public expr {
 public:
 	typedef std::shared_ptr<initializer_list_expr> Ptr;
+	initializer_list_expr() {
+		kind = block_kind::initializer_list_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::initializer_list_expr;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<initializer_list_expr>());
@@ -671,17 +875,27 @@ public:
 class foreign_expr_base : public expr {
 public:
 	typedef std::shared_ptr<foreign_expr_base> Ptr;
+	static bool classof(const block *b) {
+		return b->kind == block_kind::foreign_expr_base;
+	}
 	// We do not need any other functions because this class is guaranteed
 	// to abstract
 protected:
 	// We will add a protected constructor to make sure that this is truly
 	// abstract
-	foreign_expr_base() = default;
+	foreign_expr_base() {
+		kind = block_kind::foreign_expr_base;
+	}
 };
 template <typename T>
 class foreign_expr : public foreign_expr_base {
 public:
 	typedef std::shared_ptr<foreign_expr> Ptr;
+	// All foreign_exprs have the same kind, the type of the inner expr 
+	// is checked with RTTI
+	static bool classof(const block *b) {
+		return dynamic_cast<const foreign_expr<T> *>(b) != nullptr;
+	}
 	virtual void dump(std::ostream &oss, int i) override {
 		printer::indent(oss, i);
 		oss << "FOREIGN_EXPR" << std::endl;
@@ -717,6 +931,12 @@ public:
 	std::string member_name;
 
 	typedef std::shared_ptr<member_access_expr> Ptr;
+	member_access_expr() {
+		kind = block_kind::member_access_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::member_access_expr;
+	}
 	virtual void dump(std::ostream &oss, int i) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<member_access_expr>());
@@ -742,6 +962,12 @@ public:
 class addr_of_expr: public unary_expr {
 public:	
 	typedef std::shared_ptr<addr_of_expr> Ptr;
+	addr_of_expr() {
+		kind = block_kind::addr_of_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::addr_of_expr;
+	}
 	virtual void dump(std::ostream &oss, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<addr_of_expr>());
@@ -768,6 +994,12 @@ public:
 	type::Ptr type1;
 
 	typedef std::shared_ptr<cast_expr> Ptr;
+	cast_expr() {
+		kind = block_kind::cast_expr;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::cast_expr;
+	}
 	virtual void dump(std::ostream &oss, int) override;
 	virtual void accept(block_visitor* a) override {
 		a->visit(self<cast_expr>());
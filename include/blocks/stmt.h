@@ -7,6 +7,12 @@ namespace block {
 class stmt : public block {
 public:
 	typedef std::shared_ptr<stmt> Ptr;
+	stmt() {
+		kind = block_kind::stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind >= block_kind::stmt && b->kind <= block_kind::return_stmt;
+	}
 	std::set<std::string> annotation;
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
@@ -30,6 +36,12 @@ std::shared_ptr<T> clone_stmt(T* t) {
 class expr_stmt : public stmt {
 public:
 	typedef std::shared_ptr<expr_stmt> Ptr;
+	expr_stmt() {
+		kind = block_kind::expr_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::expr_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<expr_stmt>());
@@ -61,6 +73,12 @@ public:
 class stmt_block : public stmt {
 public:
 	typedef std::shared_ptr<stmt_block> Ptr;
+	stmt_block() {
+		kind = block_kind::stmt_block;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::stmt_block;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<stmt_block>());
@@ -92,6 +110,12 @@ public:
 class decl_stmt : public stmt {
 public:
 	typedef std::shared_ptr<decl_stmt> Ptr;
+	decl_stmt() {
+		kind = block_kind::decl_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::decl_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<decl_stmt>());
@@ -146,6 +170,12 @@ public:
 class if_stmt : public stmt {
 public:
 	typedef std::shared_ptr<if_stmt> Ptr;
+	if_stmt() {
+		kind = block_kind::if_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::if_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<if_stmt>());
@@ -190,6 +220,12 @@ public:
 class case_stmt: public stmt {
 public:
 	typedef std::shared_ptr<case_stmt> Ptr;
+	case_stmt() {
+		kind = block_kind::case_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::case_stmt;
+	}
 	virtual void dump(std::ostream&, int) override;
 	virtual void accept(block_visitor* a) override {
 		a->visit(self<case_stmt>());
@@ -234,6 +270,12 @@ public:
 class switch_stmt: public stmt {
 public:
 	typedef std::shared_ptr<switch_stmt> Ptr;
+	switch_stmt() {
+		kind = block_kind::switch_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::switch_stmt;
+	}
 	virtual void dump(std::ostream&, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<switch_stmt>());
@@ -267,6 +309,12 @@ public:
 class label : public block {
 public:
 	typedef std::shared_ptr<label> Ptr;
+	label() {
+		kind = block_kind::label;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::label;
+	}
 	virtual void dump(std::ostream &, int) override;
 	std::string label_name;
 	virtual void accept(block_visitor *a) override {
@@ -289,6 +337,12 @@ public:
 class label_stmt : public stmt {
 public:
 	typedef std::shared_ptr<label_stmt> Ptr;
+	label_stmt() {
+		kind = block_kind::label_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::label_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<label_stmt>());
@@ -313,6 +367,12 @@ public:
 class goto_stmt : public stmt {
 public:
 	typedef std::shared_ptr<goto_stmt> Ptr;
+	goto_stmt() {
+		kind = block_kind::goto_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::goto_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<goto_stmt>());
@@ -346,6 +406,12 @@ public:
 class while_stmt : public stmt {
 public:
 	typedef std::shared_ptr<while_stmt> Ptr;
+	while_stmt() {
+		kind = block_kind::while_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::while_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<while_stmt>());
@@ -375,6 +441,12 @@ public:
 class for_stmt : public stmt {
 public:
 	typedef std::shared_ptr<for_stmt> Ptr;
+	for_stmt() {
+		kind = block_kind::for_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::for_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<for_stmt>());
@@ -410,6 +482,12 @@ public:
 class break_stmt : public stmt {
 public:
 	typedef std::shared_ptr<break_stmt> Ptr;
+	break_stmt() {
+		kind = block_kind::break_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::break_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<break_stmt>());
@@ -427,6 +505,12 @@ public:
 class continue_stmt : public stmt {
 public:
 	typedef std::shared_ptr<continue_stmt> Ptr;
+	continue_stmt() {
+		kind = block_kind::continue_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::continue_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<continue_stmt>());
@@ -445,6 +529,12 @@ public:
 class func_decl : public stmt {
 public:
 	typedef std::shared_ptr<func_decl> Ptr;
+	func_decl() {
+		kind = block_kind::func_decl;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::func_decl;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<func_decl>());
@@ -508,6 +598,12 @@ public:
 class struct_decl : public stmt {
 public:
 	typedef std::shared_ptr<struct_decl> Ptr;
+	struct_decl() {
+		kind = block_kind::struct_decl;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::struct_decl;
+	}
 	virtual void dump(std::ostream&, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<struct_decl>());
@@ -557,6 +653,12 @@ public:
 class return_stmt : public stmt {
 public:
 	typedef std::shared_ptr<return_stmt> Ptr;
+	return_stmt() {
+		kind = block_kind::return_stmt;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::return_stmt;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<return_stmt>());
@@ -8,6 +8,12 @@ namespace block {
 class type : public block {
 public:
 	typedef std::shared_ptr<type> Ptr;
+	type() {
+		kind = block_kind::type;
+	}
+	static bool classof(const block *b) {
+		return b->kind >= block_kind::type && b->kind <= block_kind::anonymous_type;
+	}
 
 	bool is_const = false;
 	bool is_volatile = false;
@@ -29,6 +35,12 @@ std::shared_ptr<T> clone_type(T* t) {
 class scalar_type : public type {
 public:
 	typedef std::shared_ptr<scalar_type> Ptr;
+	scalar_type() {
+		kind = block_kind::scalar_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::scalar_type;
+	}
 	enum {
 		SHORT_INT_TYPE,
 		UNSIGNED_SHORT_INT_TYPE,
@@ -66,6 +78,12 @@ public:
 class pointer_type : public type {
 public:
 	typedef std::shared_ptr<pointer_type> Ptr;
+	pointer_type() {
+		kind = block_kind::pointer_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::pointer_type;
+	}
 	type::Ptr pointee_type;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<pointer_type>());
@@ -87,6 +105,12 @@ public:
 class reference_type : public type {
 public:
 	typedef std::shared_ptr<reference_type> Ptr;
+	reference_type() {
+		kind = block_kind::reference_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::reference_type;
+	}
 	type::Ptr referenced_type;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<reference_type>());
@@ -107,6 +131,12 @@ public:
 class function_type : public type {
 public:
 	typedef std::shared_ptr<function_type> Ptr;
+	function_type() {
+		kind = block_kind::function_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::function_type;
+	}
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<function_type>());
 	}
@@ -139,6 +169,12 @@ public:
 class array_type : public type {
 public:
 	typedef std::shared_ptr<array_type> Ptr;
+	array_type() {
+		kind = block_kind::array_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::array_type;
+	}
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<array_type>());
 	}
@@ -164,6 +200,12 @@ public:
 class builder_var_type : public type {
 public:
 	typedef std::shared_ptr<builder_var_type> Ptr;
+	builder_var_type() {
+		kind = block_kind::builder_var_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::builder_var_type;
+	}
 	enum { DYN_VAR, STATIC_VAR } builder_var_type_id;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<builder_var_type>());
@@ -189,6 +231,12 @@ public:
 class named_type : public type {
 public:
 	typedef std::shared_ptr<named_type> Ptr;
+	named_type() {
+		kind = block_kind::named_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::named_type;
+	}
 	std::string type_name;
 	std::vector<type::Ptr> template_args;
 	virtual void accept(block_visitor *a) override {
@@ -221,6 +269,12 @@ public:
 class anonymous_type : public type {
 public:
 	typedef std::shared_ptr<anonymous_type> Ptr;
+	anonymous_type() {
+		kind = block_kind::anonymous_type;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::anonymous_type;
+	}
 
 	// This is specifically a struct_decl, but since struct_decl isn't defined yet we
 	// will use a block
@@ -250,6 +304,12 @@ public:
 class var : public block {
 public:
 	typedef std::shared_ptr<var> Ptr;
+	var() {
+		kind = block_kind::var;
+	}
+	static bool classof(const block *b) {
+		return b->kind == block_kind::var;
+	}
 	virtual void dump(std::ostream &, int) override;
 	virtual void accept(block_visitor *a) override {
 		a->visit(self<var>());
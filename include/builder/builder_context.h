@@ -6,12 +6,14 @@
 #include "builder/forward_declarations.h"
 #include "builder/signature_extract.h"
 #include "builder/run_states.h"
+#include "builder/extraction_stats.h"
 #include <functional>
 #include <list>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <cstdint>
+#include <sys/types.h>
 
 namespace builder {
 
@@ -30,8 +32,115 @@ public:
 	std::string dynamic_header_includes = "";
 	bool enable_d2x = false;	
 
+	// Number of threads to explore divergent runs with. With more than one
+	// thread, the two runs created at every branch are extracted in parallel
+	// on a work stealing pool. The generated code is the same, except with 
+	// feature_unstructured where the placement of labels depends on the order 
+	// in which runs finish
+	unsigned int extraction_threads = 1;
+
+	// Order in which the runs forked at branches are explored by the 
+	// sequential extraction. Both orders produce the same code
+	enum class traversal_order { depth_first, breadth_first };
+	traversal_order extraction_order = traversal_order::depth_first;
+	// Maximum number of runs waiting on the frontier with breadth_first 
+	// order. Beyond this runs are picked depth first till the frontier 
+	// shrinks. 0 means no limit
+	size_t max_frontier_size = 0;
+	// Continue a run past a branch on its true side instead of ending it 
+	// and replaying the prefix again for both sides. Only the run for the 
+	// false side is replayed. Only used by the sequential extraction
+	bool resume_branches = false;
+
+	// How runs that end at a branch, loop back or memoization hit get back 
+	// to the extraction. exceptions throws through the user lambda, 
+	// forced_unwind runs the same destructors without the search for a handler
+	enum class run_exit_mode { exceptions, forced_unwind };
+	run_exit_mode exit_mode = run_exit_mode::exceptions;
+
+	// Explore branches by forking the process (Linux only). The forked 
+	// process continues on the true side and streams the extracted blocks 
+	// back over a pipe, while the run itself continues on the false side, 
+	// so no run replays a prefix. If something can't be sent between 
+	// processes, the extraction falls back to replaying runs. Not used 
+	// with parallel extraction
+	bool fork_branches = false;
+
+	// When an nd_var state is updated, the function is extracted again. Keep 
+	// the memoized statements that don't depend on the updated states for 
+	// the next attempt instead of extracting everything again. Not used 
+	// with feature_unstructured, where a memoization hit jumps to a 
+	// statement the next attempt might not have generated
+	bool reuse_nd_memoization = true;
+
+	// Attempts made by the last extraction after the first one, because 
+	// nd_var states were updated
+	struct nd_retry {
+		// Memoized tags kept from the attempt before and the ones dropped 
+		// because they depend on the updated states
+		size_t kept_memoized_tags = 0;
+		size_t dropped_memoized_tags = 0;
+		// Runs the attempt executed
+		size_t runs = 0;
+	};
+	std::vector<nd_retry> nd_retries;
+
+	// Budgets for a call to extract_function_ast, 0 means no limit. Runs 
+	// and statements are counted over all the attempts, the statements are 
+	// the ones added to the blocks of the runs, including the memoized 
+	// ones copied on a hit. The budgets are checked when a run starts, so 
+	// not within forked processes. When one is exceeded 
+	// ExtractionBudgetException is thrown, naming the branches explored 
+	// most often. With budget_fallback_unstructured the function is 
+	// extracted again with feature_unstructured instead, where a 
+	// memoization hit jumps to the statements instead of copying them
+	size_t max_runs = 0;
+	size_t max_stmts = 0;
+	double max_extraction_ms = 0;
+	bool budget_fallback_unstructured = false;
+
+	bool has_budgets(void) {
+		return max_runs != 0 || max_stmts != 0 || max_extraction_ms != 0;
+	}
+
+	// Collect statistics for every call to extract_function_ast, stats 
+	// holds the ones of the last call
+	bool collect_stats = false;
+	extraction_stats stats;
+	// Also report the load of the hash tables keyed by tags and the 
+	// tables the tags are interned in
+	bool collect_hash_stats = false;
+
 	void extract_function_ast_impl(invocation_state*);
+	// Recursive extraction, used with parallel extraction
 	block::stmt::Ptr extract_ast_from_run(run_state*);
+	// Iterative extraction that keeps the pending runs on a heap allocated frontier
+	block::stmt::Ptr extract_ast_from_worklist(run_state*);
+	// Extraction in forked processes, returns nullptr if it didn't succeed
+	block::stmt::Ptr extract_ast_from_forks(run_state*);
+
+private:
+	// Executes the lambda once. If the run ends on a branch yet to be explored, 
+	// the condition statement is returned and the branch tag is set
+	block::expr_stmt::Ptr execute_run(run_state*, tracer::tag&, std::unique_lock<std::mutex>&);
+	std::unique_ptr<run_state> fork_run(run_state*, const std::vector<bool>&, bool, bool);
+	void merge_branches(run_state*, block::expr_stmt::Ptr, tracer::tag, block::stmt_block::Ptr,
+			    block::stmt_block::Ptr);
+	block::stmt_block::Ptr update_memoization(run_state*);
+	void add_execution_stats(execution_state*);
+	// Throws ExtractionBudgetException if a budget is exceeded
+	void check_budgets(run_state*);
+
+	// Called by a run in fork mode on reaching a branch, returns the side 
+	// this process continues on
+	bool fork_at_branch(run_state*, const tracer::tag&);
+	void start_forked_process(run_state*, int);
+	block::stmt_block::Ptr read_forked_result(run_state*, int, pid_t);
+	[[noreturn]] void finish_forked_run(run_state*);
+	[[noreturn]] void fail_forked_run(run_state*);
+	friend class run_state;
+
+public:
 
 	// Old API still used by some samples. TODO: phase out
 	
@@ -110,7 +110,7 @@ private:
 		if (is_under_run() && block_var) {
 			// If a variable is created outside of a run, 
 			// it doesn't need a static tag
-			tracer::tag offset = tracer::get_offset_in_function();
+			tracer::tag offset = get_run_state()->get_var_tag();
 			get_run_state()->insert_live_dyn_var(offset);
 			block_var->static_offset = offset;
 			block_var->preferred_name = utils::find_variable_name_cached(this, offset);
@@ -3,6 +3,7 @@
 #include "blocks/stmt.h"
 #include "util/tracer.h"
 #include <exception>
+#include <string>
 
 namespace builder {
 struct OutOfBoolsException : public std::exception {
@@ -22,10 +23,33 @@ struct MemoizationException : public std::exception {
 	int32_t child_id;
 };
 
+// Reason a run ended before reaching the end of the function. When runs end 
+// without exceptions, this carries what the exceptions above would have
+struct run_exit {
+	enum class exit_kind { none, out_of_bools, loop_back, memoization };
+	exit_kind kind = exit_kind::none;
+	tracer::tag static_offset;
+
+	// Only used for memoization
+	block::stmt_block::Ptr parent;
+	int32_t child_id = 0;
+};
+
 struct NonDeterministicFailureException: public std::exception {
 	NonDeterministicFailureException() {}
 };
 
+// Thrown when the extraction exceeds one of the budgets set on the 
+// builder_context. The message names the branches explored most often
+struct ExtractionBudgetException : public std::exception {
+	ExtractionBudgetException(std::string _message) : message(_message) {}
+	std::string message;
+
+	const char *what() const noexcept override {
+		return message.c_str();
+	}
+};
+
 } // namespace builder
 
 #endif
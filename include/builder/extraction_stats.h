@@ -0,0 +1,101 @@
+#ifndef BUILDER_EXTRACTION_STATS_H
+#define BUILDER_EXTRACTION_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace builder {
+
+// Load of one of the hash tables of the extraction
+struct hash_table_stats {
+	std::string name;
+	size_t size = 0;
+	size_t buckets = 0;
+	// Most keys in one bucket
+	size_t max_bucket_size = 0;
+	// Keys with the same full hash as another key, and the most keys with 
+	// the same hash
+	size_t colliding_keys = 0;
+	size_t max_collision_chain = 0;
+};
+
+template <typename Map>
+hash_table_stats measure_hash_table(const std::string &name, const Map &map) {
+	hash_table_stats s;
+	s.name = name;
+	s.size = map.size();
+	s.buckets = map.bucket_count();
+	for (size_t b = 0; b < map.bucket_count(); b++)
+		s.max_bucket_size = std::max(s.max_bucket_size, map.bucket_size(b));
+	std::unordered_map<size_t, size_t> hashes;
+	auto hasher = map.hash_function();
+	for (auto &entry : map)
+		hashes[hasher(entry.first)]++;
+	for (auto &h : hashes) {
+		if (h.second < 2)
+			continue;
+		s.colliding_keys += h.second;
+		s.max_collision_chain = std::max(s.max_collision_chain, h.second);
+	}
+	return s;
+}
+
+// Statistics of one call to extract_function_ast, collected if
+// builder_context::collect_stats is set. Runs in forked processes
+// (builder_context::fork_branches) aren't counted
+struct extraction_stats {
+	std::string func_name;
+
+	// Runs executed by all the attempts, and how the runs ended
+	size_t runs = 0;
+	size_t out_of_bools = 0;
+	size_t loop_backs = 0;
+	size_t memoization_hits = 0;
+	// Attempts that ended because an nd_var state was updated
+	size_t nd_failures = 0;
+	// Statements added to the blocks of the runs
+	size_t stmts = 0;
+	// Longest bool vector a run was replayed with
+	size_t max_bool_vector_depth = 0;
+
+	// Tags given ids by the tag factory
+	size_t tags_created = 0;
+	// Sizes of the tables at the end of the extraction
+	size_t memoized_tags = 0;
+	size_t nd_states = 0;
+	// Largest visited offsets table a run ended with
+	size_t max_visited_offsets = 0;
+
+	// Wall time of the runs and of each pass after them, in milliseconds
+	double extraction_ms = 0;
+	std::vector<std::pair<std::string, double>> pass_ms;
+
+	// Load of the hash tables at the end of the extraction, only collected 
+	// if builder_context::collect_hash_stats is set too
+	std::vector<hash_table_stats> hash_tables;
+
+	void dump_json(std::ostream &oss) const;
+};
+
+// Records the wall time of consecutive passes, a pass starts where the one
+// before it ended. Does nothing without stats
+class pass_timer {
+	extraction_stats *stats;
+	std::chrono::steady_clock::time_point last;
+
+public:
+	pass_timer(extraction_stats *stats) : stats(stats), last(std::chrono::steady_clock::now()) {}
+	// Returns the time since the last pass ended and starts the next one
+	double lap(void);
+	void end_pass(const std::string &name);
+};
+
+} // namespace builder
+
+#endif
@@ -47,7 +47,7 @@ struct with_block_var {
 	with_block_var(block::var::Ptr v, bool wd = false): var(v), with_decl(wd) {}
 };
 
-extern std::vector<dyn_var_base *> *parents_stack;
+extern thread_local std::vector<dyn_var_base *> *parents_stack;
 // Struct to initialize a dyn_var as member;
 struct as_member {
 	dyn_var_base *parent_var;
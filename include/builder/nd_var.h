@@ -40,10 +40,13 @@ public:
 
 template <typename T, typename...Args>
 std::shared_ptr<T> get_or_create_generator(tracer::tag req_tag, Args&&...args) {
+	auto lock = get_execution_state()->lock_shared_state();
 	if (get_invocation_state()->nd_state_map.find(req_tag) == get_invocation_state()->nd_state_map.end()) {
 		get_invocation_state()->nd_state_map[req_tag] = std::make_shared<T>(std::forward<Args>(args)...);
 	}
-	return std::static_pointer_cast<T>(get_invocation_state()->nd_state_map[req_tag]);
+	std::shared_ptr<nd_var_base> state = get_invocation_state()->nd_state_map[req_tag];
+	get_run_state()->use_nd_state(state.get());
+	return std::static_pointer_cast<T>(state);
 }
 
 // A simple true at top boolean nd_var wrappable type
@@ -103,9 +106,11 @@ public:
 	void require_val(typename T::value_type e) {
 		// If the required value is compatible with the current state, 
 		// return 
+		auto lock = get_execution_state()->lock_shared_state();
 		if (val->check(e)) return;
 		// Otherwise, merge update and throw
 		val->merge(e);
+		get_invocation_state()->updated_nd_states.push_back(val.get());
 		throw NonDeterministicFailureException();
 	}
 
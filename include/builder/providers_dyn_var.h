@@ -60,7 +60,7 @@ using op_fcall_ret_provider_t = typename op_fcall_ret_provider<T>::type;
 // A provider to inherit members from user defined types
 // The dyn_var class will directly inherit from this type
 
-extern bool user_defined_provider_track_members;
+extern thread_local bool user_defined_provider_track_members;
 
 template <typename T>
 struct user_defined_member_provider_begin {
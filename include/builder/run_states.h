@@ -12,6 +12,14 @@
 #include <functional>
 #include "blocks/stmt.h"
 #include "builder/tag_factory.h"
+#include "util/work_stealing_pool.h"
+#include "util/run_boundary.h"
+#include "util/persistent_map.h"
+#include "builder/exceptions.h"
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
 
 namespace builder {
 
@@ -45,7 +53,8 @@ class nd_var_base;
 
 class run_state {
 public:
-	static run_state* current_run_state;
+	// Each thread extracting runs has its own current run
+	static thread_local run_state* current_run_state;
 private:
 
 	/* Generation related members */
@@ -60,11 +69,16 @@ private:
 	std::vector<block::expr::Ptr> cached_expr_sequence;
 	unsigned int cached_expr_counter = 0;
 
+	// Tags of the dyn_vars created, runs catching up take them from here 
+	// instead of walking the stack again
+	std::vector<tracer::tag> cached_var_tags;
+	unsigned int cached_var_tag_counter = 0;
+
 	// Annotations to be attached to the next statement
 	std::set<std::string> current_annotations;
 
-	// Set of dyn_variables that are live
-	std::vector<tracer::tag_id> live_dyn_vars;
+	// Set of dyn_variables that are live, from the invocation's live var table
+	std::shared_ptr<const tracer::live_var_set> live_dyn_vars;
 
 	/* Tracing and re-execution related members */
 
@@ -74,16 +88,71 @@ private:
 	/* Tag creation fields */	
 	std::vector<static_var_base*> static_var_tuples;
 	std::vector<static_var_base*> deferred_static_var_tuples;
+	// Frame of the code that started the run, the frames walked for tags 
+	// are below it
+	void* stack_top = nullptr;
 	
 
 	/* Memoization related fields */
 	
-	// Tags visited before for loopback edges
-	std::unordered_map<tracer::tag, block::stmt::Ptr> visited_offsets;	
+	// Tags visited before for loopback edges. Both maps are persistent 
+	// so that runs forked at a branch share them with their parent, and 
+	// are keyed by the ids the tag factory gives the tags so that copying 
+	// their nodes doesn't copy the tags
+	utils::persistent_map<tracer::tag_id, block::stmt::Ptr> visited_offsets;	
 
 	// Tag deduplication set, this keeps track of tags 
 	// for statements that are the same but the statements are different
-	std::unordered_map<tracer::tag, size_t> tag_deduplication_map;
+	utils::persistent_map<tracer::tag_id, size_t> tag_deduplication_map;
+
+	/* Run ending related fields */
+
+	// Boundary to exit to when the run ends early, nullptr if the run 
+	// ends by throwing the exceptions instead
+	utils::run_boundary* exit_boundary = nullptr;
+	// Why the run ended, set before exiting to the boundary
+	run_exit pending_exit;
+
+	/* Branch resumption related fields */
+
+	// A branch the run continued past on its true side. The parent holds 
+	// the state of the run at the branch, the false side is forked from it
+	struct resumed_branch {
+		std::unique_ptr<run_state> parent;
+		block::expr_stmt::Ptr branch_stmt;
+		tracer::tag branch_offset;
+		// Bool vector that replays the run up to the branch
+		std::vector<bool> bool_vector;
+	};
+	// Continue past branches instead of ending the run
+	bool resume_branches = false;
+	std::vector<resumed_branch> resumed_branches;
+	// Bool vector that replays the run up to the current point
+	std::vector<bool> resume_bool_vector;
+
+	/* Process fork related fields */
+
+	// A branch the run forked a process at. The forked process extracted 
+	// the true side, the run itself continued on the false side
+	struct forked_branch {
+		std::unique_ptr<run_state> parent;
+		block::expr_stmt::Ptr branch_stmt;
+		tracer::tag branch_offset;
+		block::stmt_block::Ptr true_ast;
+	};
+	// Fork the process at branches instead of ending the run
+	bool fork_branches = false;
+	std::vector<forked_branch> forked_branches;
+	// Pipe the process reports its result on
+	int fork_result_fd = -1;
+	// Number of nd_var states when the process was forked
+	size_t fork_nd_states = 0;
+
+	/* ND_VAR related fields */
+
+	// nd_var states the run has created or looked up so far. The statements 
+	// added after that could depend on them
+	std::vector<nd_var_base*> used_nd_states;
 	
 	/* Parent dynamic states */
 	execution_state* e_state;
@@ -104,6 +173,16 @@ public:
 	void add_to_cached_expr(block::expr::Ptr a) {
 		cached_expr_sequence.push_back(a);
 	}
+	// Tag for a dyn_var created here, the same tag the run that recorded 
+	// the prefix captured while catching up
+	tracer::tag get_var_tag(void) {
+		if (is_catching_up() && cached_var_tag_counter < cached_var_tags.size())
+			return cached_var_tags[cached_var_tag_counter++];
+		tracer::tag offset = tracer::get_offset_in_function();
+		cached_var_tags.push_back(offset);
+		cached_var_tag_counter = cached_var_tags.size();
+		return offset;
+	}
 	void add_annotation(std::string s) {
 		current_annotations.insert(s);
 	}
@@ -115,6 +194,11 @@ public:
 
 	void insert_live_dyn_var(const tracer::tag& new_tag);
 	void remove_live_dyn_var(const tracer::tag& new_tag);
+
+	void use_nd_state(nd_var_base* state) {
+		if (std::find(used_nd_states.begin(), used_nd_states.end(), state) == used_nd_states.end())
+			used_nd_states.push_back(state);
+	}
 	
 	friend class execution_state;
 	friend class invocation_state;
@@ -133,17 +217,103 @@ public:
 	bool is_visited_tag(tracer::tag &new_tag);
 	void erase_tag(tracer::tag &erase_tag);
 	bool get_next_bool(block::expr::Ptr);
+	// Continue the run on the true side of the branch it is at
+	void resume_at_branch(const tracer::tag&);
+	// End the run before it reaches the end of the function
+	[[noreturn]] void end_run(run_exit::exit_kind, const tracer::tag&, block::stmt_block::Ptr parent = nullptr,
+				  int32_t child_id = 0);
 };
 
 class execution_state {
 	/* Memoization related fields */
-	std::unordered_map<tracer::tag, block::stmt_block::Ptr> memoized_tags;
+	// A memoized statement, the block it is in and its position in the 
+	// block, so that a hit doesn't have to search the block
+	struct memoized_stmt {
+		block::stmt_block::Ptr parent;
+		size_t index;
+	};
+	// Keyed by the ids the tag factory gives the tags
+	std::unordered_map<tracer::tag_id, memoized_stmt> memoized_tags;
 	
 	/* Parent dynamic states */
 	invocation_state* i_state;
 
+	/* Parallel extraction related fields */
+
+	// Pool to explore divergent runs on, nullptr if runs are extracted sequentially
+	utils::work_stealing_pool* pool = nullptr;
+
+	// Guards memoized_tags and the stmt blocks it points to
+	std::mutex memoization_mutex;
+	// Guards the state shared from the invocation (tag factory, nd_var state)
+	std::mutex shared_state_mutex;
+
+	// Changes to memoized_tags are recorded here while set, so that the 
+	// process a forked process reports to can make the same changes. 
+	// A nullptr block records an erase
+	std::vector<std::pair<tracer::tag_id, memoized_stmt>>* memoization_log = nullptr;
+
+	/* ND_VAR related fields */
+
+	// nd_var states each statement could depend on, statements that don't 
+	// depend on any aren't recorded. Guarded by shared_state_mutex
+	std::unordered_map<const block::stmt*, std::vector<nd_var_base*>> nd_dependencies;
+	// Statements memoized from forked processes have no recorded dependencies
+	bool nd_dependencies_known = true;
+
+	/* Statistics */
+
+	// Number of runs executed and how they ended
+	std::atomic<size_t> run_count {0};
+	std::atomic<size_t> out_of_bools_count {0};
+	std::atomic<size_t> loop_back_count {0};
+	std::atomic<size_t> memoization_count {0};
+	// Longest bool vector a run started with and largest visited offsets 
+	// table a run ended with
+	std::atomic<size_t> max_bool_vector_size {0};
+	std::atomic<size_t> max_visited_offsets {0};
+	// Statements added to the blocks of the runs
+	std::atomic<size_t> stmt_count {0};
+	// Number of times a branch was reached with no bools left, by the 
+	// location of the branch. Only counted with budgets. Guarded by 
+	// shared_state_mutex
+	std::unordered_map<tracer::tag, size_t> branch_counts;
+
+	void add_nd_dependencies(const block::stmt*, const std::vector<nd_var_base*>&);
+
 public:
 	execution_state(invocation_state* i_state): i_state(i_state) {}
+
+	// Id of the tag from the invocation's tag factory
+	tracer::tag_id get_tag_id(const tracer::tag& t);
+
+	void set_memoized(tracer::tag_id t, block::stmt_block::Ptr b, size_t index) {
+		memoized_tags[t] = {b, index};
+		if (memoization_log != nullptr)
+			memoization_log->push_back({t, {b, index}});
+	}
+	void erase_memoized(tracer::tag_id t) {
+		if (memoized_tags.erase(t) && memoization_log != nullptr)
+			memoization_log->push_back({t, {nullptr, 0}});
+	}
+
+	// Locks are only taken if runs are being extracted concurrently
+	std::unique_lock<std::mutex> lock_if_concurrent(std::mutex& m) {
+		if (pool == nullptr)
+			return std::unique_lock<std::mutex>(m, std::defer_lock);
+		return std::unique_lock<std::mutex>(m);
+	}
+	std::unique_lock<std::mutex> lock_memoization(void) {
+		return lock_if_concurrent(memoization_mutex);
+	}
+	std::unique_lock<std::mutex> lock_shared_state(void) {
+		return lock_if_concurrent(shared_state_mutex);
+	}
+
+	// Takes over the memoized statements of an execution that ended because 
+	// nd_var states were updated, except the ones that depend on the updated 
+	// states. Returns the number of memoized tags kept
+	size_t reuse_memoization(execution_state& failed, const std::vector<nd_var_base*>& updated_states);
 	
 	friend class invocation_state;
 	friend class run_state;
@@ -154,9 +324,22 @@ public:
 class invocation_state {
 	/* ND_VAR state */
 	std::unordered_map<tracer::tag, std::shared_ptr<nd_var_base>> nd_state_map;
+	// States updated since the last execution started
+	std::vector<nd_var_base*> updated_nd_states;
+
+	/* Budget related fields */
+	std::chrono::steady_clock::time_point extraction_start;
+	// Runs and statements of the attempts that ended on nd_var updates
+	size_t previous_runs = 0;
+	size_t previous_stmts = 0;
 
 	// Tag factory state
 	tag_factory tag_factory_instance;
+	// Call stacks and live dyn_vars of the tags captured by the runs
+	tracer::call_stack_trie call_stack_trie_instance;
+	tracer::live_var_table live_var_table_instance;
+	// Snapshots of the static vars in the tags captured by the runs
+	snapshot_table snapshot_table_instance;
 
 	// Main invocation function
 	std::function<void(void)> invocation_function;
@@ -167,8 +350,10 @@ class invocation_state {
 	builder_context* b_ctx = nullptr;
 	
 	// Arena is part of the invocation state
-	// so the buffers persist
+	// so the buffers persist. The main thread uses var_arena, 
+	// worker i of a parallel extraction uses worker_arenas[i - 1]
 	dyn_var_arena var_arena;
+	std::vector<std::unique_ptr<dyn_var_arena>> worker_arenas;
 
 public:
 
@@ -186,10 +371,18 @@ public:
 
 	template <typename T, typename...Args>
 	friend std::shared_ptr<T> get_or_create_generator(tracer::tag req_tag, Args&&...args);
+	template <typename T>
+	friend class nd_var;
+	template <typename T>
+	friend class static_var;
+	friend tracer::tag tracer::get_offset_in_function(void);
 
 public:
 	dyn_var_arena* get_arena(void) {
-		return &var_arena;
+		int worker = utils::work_stealing_pool::current_worker_index();
+		if (worker <= 0 || worker > (int)worker_arenas.size())
+			return &var_arena;
+		return worker_arenas[worker - 1].get();
 	}
 };
 
@@ -36,6 +36,10 @@ public:
 	T val;
 	bool is_deferred = false;
 
+	// Snapshot of the value the last tag was taken with, shared by the tags 
+	// till the value changes
+	typename static_var_snapshot<T>::Ptr cached_snapshot;
+
 	mutable bool name_checked = false;
 
 	void try_get_name() const {
@@ -145,7 +149,14 @@ public:
 	}
 		
 	static_var_snapshot_base::Ptr snapshot() override {
-		return std::make_shared<static_var_snapshot<T>>(val);
+		// The value can be changed through the references handed out, so 
+		// the cached snapshot is checked against it
+		if (cached_snapshot == nullptr || !(cached_snapshot->snapshot == val)) {
+			run_state *r_state = get_run_state();
+			auto lock = r_state->get_e_state()->lock_shared_state();
+			cached_snapshot = r_state->get_i_state()->snapshot_table_instance.get<T>(val);
+		}
+		return cached_snapshot;
 	}
 };
 
@@ -163,7 +174,14 @@ public:
 	T *val = nullptr;
 	size_t actual_size = -1;
 
+	// Bumped whenever the array could have been written, the cached 
+	// snapshot is only checked against the array if the version changed
+	size_t version = 0;
+	size_t snapshot_version = -1;
+	typename static_var_snapshot<T[]>::Ptr cached_snapshot;
+
 	T &operator[](size_t index) {
+		version++;
 		return val[index];
 	}
 	const T &operator[](size_t index) const {
@@ -192,6 +210,7 @@ public:
 		delete[] val;
 		val = new_ptr;
 		actual_size = s;
+		version++;
 		// tracking tuples dont' need to be changed anymore since we are tracking the static_var itself
 	}
 	~static_var() {
@@ -217,7 +236,11 @@ public:
 		return "<array>";
 	}
 	static_var_snapshot_base::Ptr snapshot() override {
-		return std::make_shared<static_var_snapshot<T[]>>(val, actual_size);
+		if (cached_snapshot == nullptr || snapshot_version != version) {
+			cached_snapshot = static_var_snapshot<T[]>::update(cached_snapshot, val, actual_size);
+			snapshot_version = version;
+		}
+		return cached_snapshot;
 	}
 };
 } // namespace builder
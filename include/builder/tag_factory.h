@@ -8,14 +8,25 @@ namespace builder {
 class tag_factory {
 	std::unordered_map<tracer::tag, tracer::tag_id> internal_map;
 	tracer::tag_id next_id = 1;
+
+	friend class builder_context;
 public:
+	// Tags given new ids are recorded here while set, so that the process 
+	// a forked process reports to can create the same ids
+	std::vector<tracer::tag>* created_tags = nullptr;
+
 	tracer::tag_id create_tag_id (const tracer::tag& t) {
 		auto it = internal_map.find(t);
 		if (it != internal_map.end()) 
 			return it->second;
 		internal_map[t] = next_id++;
+		if (created_tags != nullptr)
+			created_tags->push_back(t);
 		return next_id - 1;
 	}
+	size_t size(void) const {
+		return internal_map.size();
+	}
 };
 
 }
@@ -1,5 +1,6 @@
 #ifndef BUILDER_TO_EXPR_H
 #define BUILDER_TO_EXPR_H
+#include <initializer_list>
 #include <utility>
 #include "builder/forward_declarations.h"
 namespace builder {
@@ -8,13 +9,13 @@ namespace builder {
 // This handles removing childred from UC, adding new expresisons to UC 
 // and caching for runs, the children, aren't set but are removed from UC
 template <typename T>
-typename T::Ptr create_expr(const std::vector<block::expr::Ptr> &children) {
+typename T::Ptr create_expr(const block::expr::Ptr *children, size_t children_count) {
 	// Caching happens here
 	if (get_run_state()->is_catching_up()) {
 		return block::to<T>(get_run_state()->get_next_cached_expr());
 	}	
-	for (auto c: children) {
-		get_run_state()->remove_node_from_sequence(c);
+	for (size_t i = 0; i < children_count; i++) {
+		get_run_state()->remove_node_from_sequence(children[i]);
 	}		
 	tracer::tag offset = tracer::get_offset_in_function();	
 	typename T::Ptr expr = std::make_shared<T>();
@@ -25,6 +26,16 @@ typename T::Ptr create_expr(const std::vector<block::expr::Ptr> &children) {
 	get_run_state()->add_to_cached_expr(expr);
 	return expr;
 }
+// Operators pass their operands in a list on the stack instead of 
+// allocating a vector for every expression
+template <typename T>
+typename T::Ptr create_expr(std::initializer_list<block::expr::Ptr> children) {
+	return create_expr<T>(children.begin(), children.size());
+}
+template <typename T>
+typename T::Ptr create_expr(const std::vector<block::expr::Ptr> &children) {
+	return create_expr<T>(children.data(), children.size());
+}
 
 
 // Single conversion function to convert anything into 
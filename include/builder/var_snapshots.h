@@ -2,9 +2,52 @@
 #define BUILDER_VAR_SNAPSHOTS_H
 
 #include "util/mtp_utils.h"
+#include <cstring>
+#include <memory>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
 
 namespace builder {
 
+// Copies snapshot values to and from bytes, so that the fork based extraction
+// can send them to the parent process. Only trivially copyable types can
+// be copied, for other types write returns false
+template <typename T, bool = std::is_trivially_copyable<T>::value>
+struct snapshot_bytes {
+	static bool write(const T &val, std::string &out) {
+		return false;
+	}
+	static bool write(const std::vector<T> &vals, std::string &out) {
+		return false;
+	}
+	template <typename F>
+	static void read(const std::string &in, F create) {}
+};
+
+template <typename T>
+struct snapshot_bytes<T, true> {
+	static bool write(const T &val, std::string &out) {
+		out.append((const char *)&val, sizeof(T));
+		return true;
+	}
+	static bool write(const std::vector<T> &vals, std::string &out) {
+		// Copied one at a time because std::vector<bool> doesn't store bools
+		for (T val : vals)
+			write(val, out);
+		return true;
+	}
+	// Calls create with the values read and their count
+	template <typename F>
+	static void read(const std::string &in, F create) {
+		size_t n = in.size() / sizeof(T);
+		typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_t;
+		std::unique_ptr<storage_t[]> vals(new storage_t[n > 0 ? n : 1]);
+		memcpy((void *)vals.get(), in.data(), sizeof(T) * n);
+		create((const T *)vals.get(), n);
+	}
+};
+
 // A base class for all static variable snapshots
 // snapshots are shared_ptr allocated so that multiple tags
 // can freely share snapshots, also allows freely caching snapshots
@@ -17,6 +60,12 @@ public:
 	virtual ~static_var_snapshot_base();
 	virtual std::string serialize() = 0;
 
+	// Write the value as bytes, returns false if the type can't be copied as bytes
+	virtual bool to_bytes(std::string &out) = 0;
+	// Function to create the snapshot back from the bytes
+	typedef Ptr (*from_bytes_t)(const std::string &);
+	virtual from_bytes_t get_from_bytes(void) = 0;
+
 	// A precomputed hash separate from all implementations
 	size_t computed_hash = 0;
 };
@@ -42,6 +91,19 @@ public:
 	std::string serialize() {
 		return utils::can_to_string<T>::get_string(snapshot);
 	}
+	bool to_bytes(std::string &out) {
+		return snapshot_bytes<T>::write(snapshot, out);
+	}
+	static static_var_snapshot_base::Ptr from_bytes(const std::string &in) {
+		static_var_snapshot_base::Ptr ret;
+		snapshot_bytes<T>::read(in, [&](const T *vals, size_t n) {
+			ret = std::make_shared<static_var_snapshot<T>>(vals[0]);
+		});
+		return ret;
+	}
+	from_bytes_t get_from_bytes(void) {
+		return from_bytes;
+	}
 };
 
 // Fixed sized arrays are handled differently
@@ -83,6 +145,19 @@ public:
 		output += "}";
 		return output;
 	}
+	bool to_bytes(std::string &out) {
+		return snapshot_bytes<T>::write(snapshot, out);
+	}
+	static static_var_snapshot_base::Ptr from_bytes(const std::string &in) {
+		static_var_snapshot_base::Ptr ret;
+		snapshot_bytes<T>::read(in, [&](const T *vals, size_t n) {
+			ret = std::make_shared<static_var_snapshot<T[size]>>(vals);
+		});
+		return ret;
+	}
+	from_bytes_t get_from_bytes(void) {
+		return from_bytes;
+	}
 };
 
 template <typename T>
@@ -91,17 +166,36 @@ public:
 	typedef std::shared_ptr<static_var_snapshot<T[]>> Ptr;
 	std::vector<T> snapshot;
 
+	// The hash is a sum over the elements, so that a snapshot that differs 
+	// in a few elements from another can update its hash
+	static size_t element_hash(size_t index, const T& val) {
+		return tracer::hash_combine(index, tracer::hash_helper<T>::get_hash(val));
+	}
+
 	// Flexible array sizes would accept an extra parameter
 	static_var_snapshot(const T* s, size_t size): snapshot(s, s + size) {
-		if (snapshot.size() == 0) {
-			computed_hash = typeid(T).hash_code();
-		} else {
-			computed_hash = tracer::hash_helper<T>::get_hash(snapshot[0]);
-			for (unsigned i = 1; i < snapshot.size(); i++) {
-				computed_hash = tracer::hash_combine(
-					computed_hash, tracer::hash_helper<T>::get_hash(snapshot[i]));
-			}
+		computed_hash = typeid(T).hash_code();
+		for (size_t i = 0; i < snapshot.size(); i++)
+			computed_hash += element_hash(i, snapshot[i]);
+	}
+	// Copies the array only if it differs from the previous snapshot, 
+	// otherwise returns the previous snapshot
+	static Ptr update(const Ptr& previous, const T* s, size_t size) {
+		if (previous == nullptr || previous->snapshot.size() != size)
+			return std::make_shared<static_var_snapshot<T[]>>(s, size);
+		size_t i = 0;
+		while (i < size && previous->snapshot[i] == s[i])
+			i++;
+		if (i == size)
+			return previous;
+		Ptr ret = std::make_shared<static_var_snapshot<T[]>>(*previous);
+		for (; i < size; i++) {
+			if (ret->snapshot[i] == s[i])
+				continue;
+			ret->computed_hash += element_hash(i, s[i]) - element_hash(i, ret->snapshot[i]);
+			ret->snapshot[i] = s[i];
 		}
+		return ret;
 	}
 
 	bool operator == (static_var_snapshot_base::Ptr _other) {
@@ -121,6 +215,51 @@ public:
 		output += "}";
 		return output;
 	}
+	bool to_bytes(std::string &out) {
+		return snapshot_bytes<T>::write(snapshot, out);
+	}
+	static static_var_snapshot_base::Ptr from_bytes(const std::string &in) {
+		static_var_snapshot_base::Ptr ret;
+		snapshot_bytes<T>::read(in, [&](const T *vals, size_t n) {
+			ret = std::make_shared<static_var_snapshot<T[]>>(vals, n);
+		});
+		return ret;
+	}
+	from_bytes_t get_from_bytes(void) {
+		return from_bytes;
+	}
+};
+
+// Hash-conses the snapshots of static vars by value, so that tags taken 
+// with the same values share the snapshot objects and compare them by 
+// pointer. Types without std::hash would all share a bucket and aren't 
+// added to the table
+class snapshot_table {
+	std::unordered_map<size_t, std::vector<static_var_snapshot_base::Ptr>> snapshots;
+
+public:
+	template <typename T>
+	typename static_var_snapshot<T>::Ptr get(const T &val) {
+		if (!tracer::hash_helper<T>::is_hashable)
+			return std::make_shared<static_var_snapshot<T>>(val);
+		auto &bucket = snapshots[tracer::hash_helper<T>::get_hash(val)];
+		for (auto &s : bucket) {
+			if (typeid(*s) != typeid(static_var_snapshot<T>))
+				continue;
+			auto snapshot = std::static_pointer_cast<static_var_snapshot<T>>(s);
+			if (snapshot->snapshot == val)
+				return snapshot;
+		}
+		auto snapshot = std::make_shared<static_var_snapshot<T>>(val);
+		bucket.push_back(snapshot);
+		return snapshot;
+	}
+	size_t size(void) const {
+		size_t n = 0;
+		for (auto &bucket : snapshots)
+			n += bucket.second.size();
+		return n;
+	}
 };
 
 // We don't need tracking tuples any more since static_vars themselves act 
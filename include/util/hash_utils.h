@@ -5,14 +5,25 @@
 #include <typeinfo>
 
 namespace tracer {
-// Just a hash_combine function
+// Finalizer of MurmurHash3, spreads the bits of small or similar values 
+// (ids, return addresses, std::hash of integers) over the whole word
+static inline size_t hash_mix(size_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// Boost's hash_combine, with the combined hash mixed first
 static inline size_t hash_combine(size_t h1, size_t h2) {
-	// Boost's simple hash_combine. Works well for most cases
-	return h1 ^ (h2 + 0x9e3779b97f4a7c15ULL + (h1 << 6) + (h1 >> 2));
+	return h1 ^ (hash_mix(h2) + 0x9e3779b97f4a7c15ULL + (h1 << 6) + (h1 >> 2));
 }
 
 template <typename T, typename V=void>
 struct hash_helper {
+	static constexpr bool is_hashable = false;
 	// default case just returns hash of just the typeid
 	static inline size_t get_hash(const T& _) {
 		return typeid(T).hash_code();
@@ -21,6 +32,7 @@ struct hash_helper {
 
 template <typename T>
 struct hash_helper<T, typename utils::check_valid_type<decltype(std::hash<T>())>::type> {
+	static constexpr bool is_hashable = true;
 	static inline size_t get_hash(const T& t) {
 		return std::hash<T>{}(t);
 	}
@@ -0,0 +1,261 @@
+#ifndef UTIL_PERSISTENT_MAP_H
+#define UTIL_PERSISTENT_MAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace utils {
+
+// Counters shared by all the persistent maps, to measure the memory they use
+struct persistent_map_counters {
+	// Trie nodes and entries currently allocated and the most allocated at once
+	static std::atomic<int64_t> live_nodes;
+	static std::atomic<int64_t> peak_nodes;
+	// Nodes copied because they were shared with another map
+	static std::atomic<int64_t> copied_nodes;
+
+	static void node_created(void) {
+		int64_t live = ++live_nodes;
+		int64_t peak = peak_nodes;
+		while (live > peak && !peak_nodes.compare_exchange_weak(peak, live))
+			;
+	}
+	static void reset(void) {
+		peak_nodes = live_nodes.load();
+		copied_nodes = 0;
+	}
+};
+
+// A hash array mapped trie. Copying the map is O(1), the copies share all
+// their nodes. An update copies the nodes on the path to the entry if they
+// are shared with another map and updates them in place otherwise, so a map
+// that isn't shared is updated as cheaply as a mutable one.
+// Copies can't be updated concurrently, but they can be read concurrently
+template <typename K, typename V, typename Hash = std::hash<K>>
+class persistent_map {
+	static const int bits_per_level = 5;
+	static const size_t slot_mask = (1 << bits_per_level) - 1;
+	static const int hash_bits = 64;
+
+	struct leaf {
+		size_t hash;
+		K key;
+		V value;
+		leaf(size_t hash, const K &key, const V &value) : hash(hash), key(key), value(value) {
+			persistent_map_counters::node_created();
+		}
+		~leaf() {
+			persistent_map_counters::live_nodes--;
+		}
+	};
+	struct node;
+	typedef std::shared_ptr<node> node_ptr;
+	typedef std::shared_ptr<const leaf> leaf_ptr;
+
+	// A slot is either a leaf or a sub trie
+	struct slot {
+		leaf_ptr entry;
+		node_ptr child;
+	};
+
+	struct node {
+		// Bit i is set if the slot for the hash bits i is present. Nodes
+		// past the last level hold all the colliding leaves and don't use it
+		uint32_t bitmap = 0;
+		std::vector<slot> slots;
+
+		node() {
+			persistent_map_counters::node_created();
+		}
+		node(const node &other) : bitmap(other.bitmap), slots(other.slots) {
+			persistent_map_counters::node_created();
+			persistent_map_counters::copied_nodes++;
+		}
+		~node() {
+			persistent_map_counters::live_nodes--;
+		}
+	};
+
+	node_ptr root;
+	size_t count = 0;
+
+	static size_t get_index(uint32_t bitmap, uint32_t bit) {
+		return __builtin_popcount(bitmap & (bit - 1));
+	}
+
+	// Returns a node that can be updated in place
+	static node_ptr make_writable(const node_ptr &n) {
+		if (n.use_count() == 1)
+			return n;
+		return std::make_shared<node>(*n);
+	}
+
+	static node_ptr make_pair_node(leaf_ptr a, leaf_ptr b, int shift) {
+		node_ptr n = std::make_shared<node>();
+		if (shift >= hash_bits) {
+			n->slots.push_back({a, nullptr});
+			n->slots.push_back({b, nullptr});
+			return n;
+		}
+		uint32_t bit_a = 1u << ((a->hash >> shift) & slot_mask);
+		uint32_t bit_b = 1u << ((b->hash >> shift) & slot_mask);
+		if (bit_a == bit_b) {
+			n->bitmap = bit_a;
+			n->slots.push_back({nullptr, make_pair_node(a, b, shift + bits_per_level)});
+			return n;
+		}
+		n->bitmap = bit_a | bit_b;
+		if (bit_a < bit_b) {
+			n->slots.push_back({a, nullptr});
+			n->slots.push_back({b, nullptr});
+		} else {
+			n->slots.push_back({b, nullptr});
+			n->slots.push_back({a, nullptr});
+		}
+		return n;
+	}
+
+	// Returns the updated node, added is set if the key wasn't present
+	static node_ptr insert(const node_ptr &n, leaf_ptr entry, int shift, bool &added) {
+		node_ptr w = make_writable(n);
+		if (shift >= hash_bits) {
+			for (auto &s : w->slots) {
+				if (s.entry->key == entry->key) {
+					s.entry = entry;
+					return w;
+				}
+			}
+			w->slots.push_back({entry, nullptr});
+			added = true;
+			return w;
+		}
+		uint32_t bit = 1u << ((entry->hash >> shift) & slot_mask);
+		size_t index = get_index(w->bitmap, bit);
+		if (!(w->bitmap & bit)) {
+			w->bitmap |= bit;
+			w->slots.insert(w->slots.begin() + index, slot{entry, nullptr});
+			added = true;
+			return w;
+		}
+		slot &s = w->slots[index];
+		if (s.child != nullptr) {
+			s.child = insert(s.child, entry, shift + bits_per_level, added);
+		} else if (s.entry->hash == entry->hash && s.entry->key == entry->key) {
+			s.entry = entry;
+		} else {
+			s.child = make_pair_node(s.entry, entry, shift + bits_per_level);
+			s.entry = nullptr;
+			added = true;
+		}
+		return w;
+	}
+
+	// Returns the updated node, nullptr if it is now empty
+	static node_ptr remove(const node_ptr &n, size_t hash, const K &key, int shift, bool &removed) {
+		if (shift >= hash_bits) {
+			for (size_t i = 0; i < n->slots.size(); i++) {
+				if (n->slots[i].entry->key == key) {
+					removed = true;
+					if (n->slots.size() == 1)
+						return nullptr;
+					node_ptr w = make_writable(n);
+					w->slots.erase(w->slots.begin() + i);
+					return w;
+				}
+			}
+			return n;
+		}
+		uint32_t bit = 1u << ((hash >> shift) & slot_mask);
+		if (!(n->bitmap & bit))
+			return n;
+		size_t index = get_index(n->bitmap, bit);
+		const slot &s = n->slots[index];
+		node_ptr child;
+		if (s.child != nullptr) {
+			child = remove(s.child, hash, key, shift + bits_per_level, removed);
+			if (!removed)
+				return n;
+			if (child != nullptr) {
+				node_ptr w = make_writable(n);
+				w->slots[index].child = child;
+				return w;
+			}
+		} else if (s.entry->hash != hash || !(s.entry->key == key)) {
+			return n;
+		}
+		removed = true;
+		if (n->slots.size() == 1)
+			return nullptr;
+		node_ptr w = make_writable(n);
+		w->bitmap &= ~bit;
+		w->slots.erase(w->slots.begin() + index);
+		return w;
+	}
+
+public:
+	// Returns the value for the key, nullptr if it isn't present
+	const V *find(const K &key) const {
+		if (root == nullptr)
+			return nullptr;
+		size_t hash = Hash()(key);
+		const node *n = root.get();
+		for (int shift = 0; shift < hash_bits; shift += bits_per_level) {
+			uint32_t bit = 1u << ((hash >> shift) & slot_mask);
+			if (!(n->bitmap & bit))
+				return nullptr;
+			const slot &s = n->slots[get_index(n->bitmap, bit)];
+			if (s.child == nullptr) {
+				if (s.entry->hash == hash && s.entry->key == key)
+					return &s.entry->value;
+				return nullptr;
+			}
+			n = s.child.get();
+		}
+		for (auto &s : n->slots)
+			if (s.entry->key == key)
+				return &s.entry->value;
+		return nullptr;
+	}
+
+	bool contains(const K &key) const {
+		return find(key) != nullptr;
+	}
+
+	void set(const K &key, const V &value) {
+		leaf_ptr entry = std::make_shared<const leaf>(Hash()(key), key, value);
+		if (root == nullptr)
+			root = std::make_shared<node>();
+		bool added = false;
+		root = insert(root, entry, 0, added);
+		if (added)
+			count++;
+	}
+
+	bool erase(const K &key) {
+		if (root == nullptr)
+			return false;
+		bool removed = false;
+		root = remove(root, Hash()(key), key, 0, removed);
+		if (removed)
+			count--;
+		return removed;
+	}
+
+	size_t size(void) const {
+		return count;
+	}
+	bool empty(void) const {
+		return count == 0;
+	}
+	void clear(void) {
+		root = nullptr;
+		count = 0;
+	}
+};
+
+} // namespace utils
+
+#endif
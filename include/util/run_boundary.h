@@ -0,0 +1,34 @@
+#ifndef UTIL_RUN_BOUNDARY_H
+#define UTIL_RUN_BOUNDARY_H
+
+#include <csetjmp>
+#include <functional>
+
+namespace utils {
+
+// A point on the stack that a function running under it can exit to
+// without throwing an exception. The exit uses a forced unwind which
+// runs the destructors of all the frames in between, but skips the
+// search for a handler that makes a throw expensive on deep stacks.
+// Once the frames are cleaned up, control jumps back to the boundary.
+// This is the same mechanism pthread_cancel uses for ending threads.
+
+struct run_boundary {
+	std::jmp_buf env;
+	// Frame address of the function that set up the boundary
+	void *frame = nullptr;
+};
+
+// Runs f under the boundary. Returns true if f exited through
+// exit_to_boundary and false if it returned normally. Exceptions
+// thrown by f propagate as usual
+bool run_under_boundary(run_boundary *b, const std::function<void(void)> &f);
+
+// Unwind the stack up to the boundary and return from the
+// run_under_boundary call that set it up. The boundary must be on
+// the stack of the current thread
+[[noreturn]] void exit_to_boundary(run_boundary *b);
+
+} // namespace utils
+
+#endif
@@ -2,6 +2,7 @@
 #define TRACER_H
 #include <execinfo.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include "util/hash_utils.h"
@@ -16,12 +17,102 @@ namespace tracer {
 
 using tag_id = size_t;
 
+// A node in a trie of call stacks, the return address of one frame and the 
+// stack of its callers. Stacks interned in the same call_stack_trie are the 
+// same node, so comparing them only compares pointers
+struct call_stack {
+	std::shared_ptr<const call_stack> parent;
+	unsigned long long address;
+	unsigned int depth;
+	size_t hash;
+
+	call_stack(std::shared_ptr<const call_stack> parent, unsigned long long address);
+	// Return addresses innermost frame first
+	std::vector<unsigned long long> get_pointers(void) const;
+};
+
+// Hash-conses call stacks by their caller and return address
+class call_stack_trie {
+	struct child_key {
+		const call_stack *parent;
+		unsigned long long address;
+		bool operator==(const child_key &other) const {
+			return parent == other.parent && address == other.address;
+		}
+	};
+	struct child_key_hash {
+		size_t operator()(const child_key &k) const {
+			return hash_combine((size_t)k.parent, std::hash<unsigned long long>{}(k.address));
+		}
+	};
+	std::unordered_map<child_key, std::shared_ptr<const call_stack>, child_key_hash> children;
+	// Nodes of the last stack interned by depth, consecutive tags mostly 
+	// share their outer frames
+	std::vector<std::shared_ptr<const call_stack>> last_stack;
+
+	friend class builder::builder_context;
+
+public:
+	// Return addresses innermost frame first, nullptr for an empty stack
+	std::shared_ptr<const call_stack> intern(const unsigned long long *pointers, size_t size);
+	size_t size(void) const {
+		return children.size();
+	}
+};
+
+// Creates a stack that isn't interned anywhere
+std::shared_ptr<const call_stack> make_call_stack(const std::vector<unsigned long long> &pointers);
+
+// The sorted ids of the live dyn_vars. The hash is a sum over the ids, so 
+// that it is updated with every insert and remove. Sets interned in the 
+// same live_var_table are the same object
+struct live_var_set {
+	std::vector<tag_id> ids;
+	size_t hash = 0;
+
+	static size_t id_hash(tag_id id);
+};
+
+// Hash-conses live var sets and remembers the set every insert and remove 
+// leads to, runs replaying the same dyn_vars get the sets without copying 
+// them. The empty set is nullptr
+class live_var_table {
+	struct transition_key {
+		const live_var_set *from;
+		tag_id id;
+		bool insert;
+		bool operator==(const transition_key &other) const {
+			return from == other.from && id == other.id && insert == other.insert;
+		}
+	};
+	struct transition_key_hash {
+		size_t operator()(const transition_key &k) const {
+			return hash_combine(hash_combine((size_t)k.from, k.id), k.insert);
+		}
+	};
+	std::unordered_map<transition_key, std::shared_ptr<const live_var_set>, transition_key_hash> transitions;
+	std::unordered_map<size_t, std::vector<std::shared_ptr<const live_var_set>>> sets;
+
+	std::shared_ptr<const live_var_set> intern(live_var_set &&set);
+
+	friend class builder::builder_context;
+
+public:
+	// from has to be nullptr or a set from this table
+	std::shared_ptr<const live_var_set> insert(const std::shared_ptr<const live_var_set> &from, tag_id id);
+	// Removes one copy of the id, if it is in the set
+	std::shared_ptr<const live_var_set> remove(const std::shared_ptr<const live_var_set> &from, tag_id id);
+};
+
+// Creates a set that isn't interned anywhere
+std::shared_ptr<const live_var_set> make_live_var_set(const std::vector<tag_id> &ids);
+
 class tag {
 public:
-	std::vector<unsigned long long> pointers;
+	std::shared_ptr<const call_stack> stack;
 	std::vector<std::shared_ptr<builder::static_var_snapshot_base>> static_var_snapshots;
 	std::vector<std::pair<std::string, std::string>> static_var_key_values;
-	std::vector<tag_id> live_dyn_vars;
+	std::shared_ptr<const live_var_set> live_dyn_vars;
 	size_t dedup_id = 0;
 
 	std::string cached_string;
@@ -32,12 +123,18 @@ public:
 		return !operator==(other);
 	}
 	bool is_empty(void) const {
-		return pointers.size() == 0;
+		return stack == nullptr;
+	}
+	// Return addresses innermost frame first
+	std::vector<unsigned long long> get_pointers(void) const {
+		if (stack == nullptr)
+			return {};
+		return stack->get_pointers();
 	}
 	void clear(void) {
-		pointers.clear();
+		stack.reset();
 		static_var_snapshots.clear();
-		live_dyn_vars.clear();
+		live_dyn_vars.reset();
 		dedup_id = 0;
 	}
 
@@ -46,7 +143,7 @@ public:
 	// and ignores the static tags
 	tag slice_loc(void) {
 		tag new_tag;
-		new_tag.pointers = pointers;
+		new_tag.stack = stack;
 		return new_tag;
 	}
 
@@ -57,6 +154,7 @@ public:
 	std::string stringify(void);
 
 	std::string stringify_loc(void) {
+		std::vector<unsigned long long> pointers = get_pointers();
 		std::string output_string = "[";
 		for (unsigned int i = 0; i < pointers.size(); i++) {
 			char temp[128];
@@ -78,9 +176,8 @@ public:
 		// We will start by hashing the pointers
 		size_t h = typeid(tag).hash_code();
 
-		for (unsigned i = 0; i < pointers.size(); i++) {
-			h = hash_combine(h, std::hash<unsigned long long>{}(pointers[1]));
-		}
+		if (stack != nullptr)
+			h = hash_combine(h, stack->hash);
 		// Now combine the hashes from each snapshot, snapshots take care of returning a fixed 
 		// hash if the type itself isn't hashable - to avoid virtual disaptches, we will pre compute hashes 
 		// in the base type
@@ -92,9 +189,8 @@ public:
 
 		// Finally combine the hash of the live_dyn_vars
 
-		for (unsigned i = 0; i < live_dyn_vars.size(); i++) {
-			h = hash_combine(h, (size_t) live_dyn_vars[i]);
-		}
+		if (live_dyn_vars != nullptr)
+			h = hash_combine(h, live_dyn_vars->hash);
 
 		// Finally add the dedup id in
 		h = hash_combine(h, dedup_id);
@@ -106,8 +202,14 @@ public:
 
 
 tag get_unique_tag(void);
+// Number of unique tags created so far. A forked process reports this back
+// so that the tags created after it stay unique
+unsigned long long get_unique_tag_count(void);
+void set_unique_tag_count(unsigned long long);
 
 tag get_offset_in_function(void);
+// Way the return addresses are captured, chosen when the library is built
+const char *get_stack_walker_name(void);
 
 } // namespace tracer
 
@@ -0,0 +1,91 @@
+#ifndef UTIL_WORK_STEALING_POOL_H
+#define UTIL_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+// A small fork-join pool used for exploring divergent runs in parallel.
+// Every worker owns a deque of tasks. Workers push and pop from the back
+// of their own deque and steal from the front of the other deques.
+// The thread that creates the pool participates as worker 0, so that it
+// can spawn tasks and help execute them while it waits in join.
+
+class work_stealing_pool;
+
+class pool_task {
+	std::function<void(void)> func;
+	std::atomic<bool> done;
+	std::exception_ptr error;
+
+public:
+	pool_task(std::function<void(void)> f) : func(f), done(false) {}
+	bool is_done(void) const {
+		return done.load(std::memory_order_acquire);
+	}
+
+	friend class work_stealing_pool;
+};
+
+class work_stealing_pool {
+	struct worker_queue {
+		std::mutex queue_mutex;
+		std::deque<pool_task *> tasks;
+	};
+
+	std::vector<std::unique_ptr<worker_queue>> queues;
+	std::vector<std::thread> threads;
+
+	// Used for putting idle workers to sleep
+	std::mutex idle_mutex;
+	std::condition_variable idle_cv;
+	std::atomic<size_t> pending_tasks;
+	std::atomic<bool> stopping;
+
+	// The pool and the index of the worker running on this thread
+	static thread_local work_stealing_pool *current_pool;
+	static thread_local int current_worker;
+
+	void worker_loop(int index);
+	pool_task *pop_local(int index);
+	pool_task *steal(int thief);
+	void run_task(pool_task *t);
+
+public:
+	// num_workers includes the calling thread
+	work_stealing_pool(unsigned int num_workers);
+	~work_stealing_pool();
+
+	work_stealing_pool(const work_stealing_pool &) = delete;
+	work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+	unsigned int num_workers(void) const {
+		return queues.size();
+	}
+
+	// Push a task on the deque of the current worker. The task
+	// object must stay alive till join returns
+	void spawn(pool_task *t);
+
+	// Wait for a task to finish, executing other tasks while waiting.
+	// If the task threw, the exception is rethrown here
+	void join(pool_task *t);
+
+	// Index of the worker running on the current thread, -1 if the
+	// current thread doesn't belong to any pool
+	static int current_worker_index(void) {
+		return current_worker;
+	}
+};
+
+} // namespace utils
+
+#endif
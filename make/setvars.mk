@@ -1,6 +1,7 @@
 # Initialize config parameters if not initialized
 RECOVER_VAR_NAMES ?= 0
 TRACER_USE_LIBUNWIND ?= 0
+TRACER_USE_FRAME_POINTERS ?= 0
 DEBUG ?= 0
 ENABLE_D2X ?= 0
 EXTRA_CFLAGS?=
@@ -53,6 +54,16 @@ ifeq ($(TRACER_USE_LIBUNWIND),1)
 CFLAGS_INTERNAL+=-DTRACER_USE_LIBUNWIND
 endif
 
+# The frame pointer chain is only complete if the code using the library 
+# keeps the frame pointers too, so the flag is part of the exported CFLAGS
+ifeq ($(TRACER_USE_FRAME_POINTERS),1)
+ifeq ($(TRACER_USE_LIBUNWIND),1)
+$(error TRACER_USE_FRAME_POINTERS and TRACER_USE_LIBUNWIND cannot be used together)
+endif
+CFLAGS_INTERNAL+=-DTRACER_USE_FRAME_POINTERS
+CFLAGS+=-fno-omit-frame-pointer
+endif
+
 
 LIBUNWIND_PATH ?= _UNSET_
 ifeq ($(RECOVER_VAR_NAMES),1)
@@ -73,6 +84,6 @@ endif
 endif
 
 
-LINKER_FLAGS+=-ldl
+LINKER_FLAGS+=-ldl -lpthread
 CFLAGS+=$(EXTRA_CFLAGS)
 # --- flags are all ready
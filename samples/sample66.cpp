@@ -0,0 +1,38 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// A kernel with many data dependent branches inside a static loop
+static void bar(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 6; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+			if (sum > 100)
+				sum = 0;
+		} else {
+			sum = sum - i;
+		}
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		if (buffer[j] == sum)
+			buffer[j] = 0;
+		j = j + 1;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	// Explore the branches on 4 threads
+	context.extraction_threads = 4;
+	auto ast = context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	return 0;
+}
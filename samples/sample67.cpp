@@ -0,0 +1,41 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// A fully unrolled decision tree, every level adds a nested branch
+static void classify(dyn_var<int *> &features, dyn_var<int> &label, int depth, int node) {
+	if (depth == 0) {
+		label = node;
+		return;
+	}
+	if (features[depth] > node * 10)
+		classify(features, label, depth - 1, node * 2 + 1);
+	else
+		classify(features, label, depth - 1, node * 2);
+}
+
+static dyn_var<int> bar(dyn_var<int *> features) {
+	dyn_var<int> label = 0;
+	classify(features, label, 3, 1);
+	return label;
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	auto ast = context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+
+	// Explore the same function breadth first with a bounded frontier
+	builder::builder_context bfs_context;
+	bfs_context.extraction_order = builder::builder_context::traversal_order::breadth_first;
+	bfs_context.max_frontier_size = 4;
+	ast = bfs_context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	return 0;
+}
@@ -0,0 +1,37 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Static and dynamic variables live across the points where runs end,
+// their destructors have to run for the tags to stay correct
+static void bar(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 4; i++) {
+		static_var<int> scale = i * 2;
+		dyn_var<int> x = buffer[i] * scale;
+		if (x > n)
+			sum = sum + x;
+		else
+			sum = sum - i;
+	}
+	while (sum > n) {
+		static_var<int> step = 3;
+		sum = sum - step;
+	}
+	buffer[0] = sum;
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	// End runs with a forced unwind instead of exceptions
+	context.exit_mode = builder::builder_context::run_exit_mode::forced_unwind;
+	auto ast = context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark comparing the two ways runs end, throwing exceptions and
+// forced unwinds to the run boundary. The kernels are taken from the
+// samples, sample66 (many branches), sample67 (nested branches) and
+// a variant of sample67 that ends every run deep in the call stack
+
+static void branches(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 6; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+			if (sum > 100)
+				sum = 0;
+		} else {
+			sum = sum - i;
+		}
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		if (buffer[j] == sum)
+			buffer[j] = 0;
+		j = j + 1;
+	}
+}
+
+static void classify(dyn_var<int *> &features, dyn_var<int> &label, int depth, int node) {
+	if (depth == 0) {
+		label = node;
+		return;
+	}
+	if (features[depth] > node * 10)
+		classify(features, label, depth - 1, node * 2 + 1);
+	else
+		classify(features, label, depth - 1, node * 2);
+}
+
+static dyn_var<int> tree(dyn_var<int *> features) {
+	dyn_var<int> label = 0;
+	classify(features, label, 6, 1);
+	return label;
+}
+
+static void descend(dyn_var<int *> &features, dyn_var<int> &label, int frames, int depth) {
+	if (frames > 0) {
+		static_var<int> frame = frames;
+		descend(features, label, frames - 1, depth);
+		return;
+	}
+	classify(features, label, depth, 1);
+}
+
+static dyn_var<int> deep_tree(dyn_var<int *> features) {
+	dyn_var<int> label = 0;
+	descend(features, label, 64, 4);
+	return label;
+}
+
+template <typename F>
+static double time_extraction(F func, builder::builder_context::run_exit_mode mode, int iterations,
+			      std::string &code) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		builder::builder_context context;
+		context.exit_mode = mode;
+		auto ast = context.extract_function_ast(func, "func");
+		if (i == 0) {
+			std::ostringstream oss;
+			block::c_code_generator::generate_code(ast, oss, 0);
+			code = oss.str();
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+template <typename F>
+static void compare(std::string name, F func, int iterations) {
+	std::string exception_code, unwind_code;
+	double exception_ms =
+	    time_extraction(func, builder::builder_context::run_exit_mode::exceptions, iterations, exception_code);
+	double unwind_ms =
+	    time_extraction(func, builder::builder_context::run_exit_mode::forced_unwind, iterations, unwind_code);
+	std::cout << name << ": exceptions " << exception_ms << " ms, forced_unwind " << unwind_ms << " ms, speedup "
+		  << exception_ms / unwind_ms << "x" << (exception_code == unwind_code ? "" : " (CODE DIFFERS)")
+		  << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	compare("branches", branches, 20);
+	compare("tree", tree, 5);
+	compare("deep_tree", deep_tree, 5);
+	return 0;
+}
@@ -0,0 +1,38 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Straight line code with branches, nested branches and a loop
+static void bar(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 5; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+			if (sum > 100)
+				sum = 0;
+		}
+		sum = sum * 2;
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		if (buffer[j] == sum)
+			break;
+		j = j + 1;
+	}
+	buffer[0] = j;
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	// Continue runs on the true side of branches instead of replaying them
+	context.resume_branches = true;
+	auto ast = context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	return 0;
+}
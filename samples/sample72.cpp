@@ -0,0 +1,69 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include "util/persistent_map.h"
+#include <chrono>
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for the state runs forked at branches copy from their parent.
+// The visited offsets and deduplication tags are persistent maps, the
+// counters report how many of their nodes were copied and the most nodes
+// alive at once. The kernels are sample66 (sample scale) and a long straight
+// line program with a branch every few statements (large scale)
+
+static void branches(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 6; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+			if (sum > 100)
+				sum = 0;
+		} else {
+			sum = sum - i;
+		}
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		if (buffer[j] == sum)
+			buffer[j] = 0;
+		j = j + 1;
+	}
+}
+
+static void long_program(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 2000; i++) {
+		sum = sum + buffer[i];
+		if (i % 50 == 0) {
+			if (sum > n)
+				sum = 0;
+		}
+	}
+	buffer[0] = sum;
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	utils::persistent_map_counters::reset();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		builder::builder_context context;
+		context.extract_function_ast(func, "func");
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	std::cout << name << ": " << ms << " ms, " << utils::persistent_map_counters::copied_nodes / iterations
+		  << " nodes copied, " << utils::persistent_map_counters::peak_nodes << " nodes at peak" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	measure("branches", branches, 20);
+	measure("long_program", long_program, 1);
+	return 0;
+}
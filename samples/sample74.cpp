@@ -0,0 +1,47 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/nd_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::nd_var;
+using builder::static_var;
+
+// Branches, a loop and an nd_var update
+static void bar(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 3; i++) {
+		if (buffer[i] > n)
+			sum = sum + buffer[i];
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		nd_var<builder::true_top> t;
+		t.require_val(builder::true_top::T);
+		j = j + (int)t.get()->value;
+	}
+	buffer[0] = sum;
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	context.collect_stats = true;
+	auto ast = context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+
+	// The times vary between executions, the full stats go to stderr
+	const builder::extraction_stats &stats = context.stats;
+	std::cout << "// runs: " << stats.runs << std::endl;
+	std::cout << "// out of bools: " << stats.out_of_bools << std::endl;
+	std::cout << "// loop backs: " << stats.loop_backs << std::endl;
+	std::cout << "// memoization hits: " << stats.memoization_hits << std::endl;
+	std::cout << "// nd failures: " << stats.nd_failures << std::endl;
+	std::cout << "// max bool vector depth: " << stats.max_bool_vector_depth << std::endl;
+	std::cout << "// nd states: " << stats.nd_states << std::endl;
+	std::cout << "// passes: " << stats.pass_ms.size() << std::endl;
+	stats.dump_json(std::cerr);
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// The static count is different on every path, so every path is extracted
+// separately and the runs grow exponentially with the loop bound
+static void blowup(dyn_var<int *> buffer, dyn_var<int> n) {
+	static_var<int> count = 0;
+	for (static_var<int> i = 0; i < 16; i++) {
+		if (buffer[i] > n)
+			count++;
+	}
+	buffer[0] = count;
+}
+
+// Every memoization hit copies the statements till the end of the function
+static void copies(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 8; i++) {
+		if (buffer[i] > n)
+			sum = sum + buffer[i];
+	}
+	buffer[0] = sum;
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	context.max_runs = 100;
+	try {
+		context.extract_function_ast(blowup, "blowup");
+	} catch (builder::ExtractionBudgetException &e) {
+		// The rest of the message has the addresses of the branches
+		std::string message = e.what();
+		std::cout << "// " << message.substr(0, message.find('\n')) << std::endl;
+	}
+
+	builder::builder_context fallback_context;
+	fallback_context.max_stmts = 40;
+	fallback_context.budget_fallback_unstructured = true;
+	auto ast = fallback_context.extract_function_ast(copies, "copies");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for capturing tags, which walks the stack up to the extracted
+// function for every dyn_var and expression. The library walks the stack
+// with glibc backtrace, libunwind or the frame pointers, depending on how
+// it was built. Compare the three with the builds from
+//     make
+//     make TRACER_USE_LIBUNWIND=1
+//     make TRACER_USE_FRAME_POINTERS=1
+// The kernels are sample70, a matrix product unrolled by static loops and a
+// helper called at increasing depths to capture tags with longer stacks, 
+// and dyn_vars created before a chain of branches that every run replays. 
+// The cost of one capture is measured by capturing tags in a loop
+
+static void branches(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 5; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+			if (sum > 100)
+				sum = 0;
+		}
+		sum = sum * 2;
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		if (buffer[j] == sum)
+			break;
+		j = j + 1;
+	}
+	buffer[0] = j;
+}
+
+static void matrix(dyn_var<int *> a, dyn_var<int *> b, dyn_var<int *> c) {
+	for (static_var<int> i = 0; i < 8; i++)
+		for (static_var<int> j = 0; j < 8; j++)
+			c[i * 8 + j] = a[i * 8 + j] * b[j * 8 + i] + c[i * 8 + j];
+}
+
+static void nested(dyn_var<int *> buffer, int depth) {
+	if (depth > 0) {
+		nested(buffer, depth - 1);
+		return;
+	}
+	for (static_var<int> i = 0; i < 50; i++)
+		buffer[i] = buffer[i] + i;
+}
+
+static void deep_stack(dyn_var<int *> buffer) {
+	for (static_var<int> depth = 0; depth < 20; depth++)
+		nested(buffer, depth);
+}
+
+static void replayed(dyn_var<int *> buffer, dyn_var<int> n) {
+	std::vector<dyn_var<int> *> vars;
+	for (static_var<int> i = 0; i < 100; i++)
+		vars.push_back(new dyn_var<int>(buffer[i]));
+	for (static_var<int> i = 0; i < 20; i++) {
+		if (buffer[i] > n)
+			buffer[i] = *vars[i];
+	}
+	for (auto var : vars)
+		delete var;
+}
+
+static const int captures = 20000;
+static void capture_tags(dyn_var<int *> buffer) {
+	for (int i = 0; i < captures; i++)
+		tracer::get_offset_in_function();
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		builder::builder_context context;
+		context.extract_function_ast(func, "func");
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	std::cout << name << ": " << ms << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	std::cout << "Stack walked with " << tracer::get_stack_walker_name() << std::endl;
+	measure("branches", branches, 20);
+	measure("matrix", matrix, 20);
+	measure("deep_stack", deep_stack, 5);
+	measure("replayed", replayed, 5);
+
+	auto start = std::chrono::steady_clock::now();
+	builder::builder_context context;
+	context.extract_function_ast(capture_tags, "func");
+	auto end = std::chrono::steady_clock::now();
+	double us = std::chrono::duration<double, std::micro>(end - start).count() / captures;
+	std::cout << "per tag: " << us << " us" << std::endl;
+	return 0;
+}
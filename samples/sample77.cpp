@@ -0,0 +1,54 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <chrono>
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for tags taken with a large static_var<int[]> alive. Every tag
+// holds a snapshot of the array, the kernels read a 16 KB lookup table, and
+// write one entry of it every few statements
+
+static void lookup(dyn_var<int *> buffer) {
+	static_var<int[]> table;
+	table.resize(4096);
+	for (static_var<int> i = 0; i < 4096; i++)
+		table[i] = i * 7 % 31;
+	for (static_var<int> i = 0; i < 200; i++)
+		buffer[i] = buffer[i] + table[i * 13 % 4096];
+}
+
+static void update(dyn_var<int *> buffer) {
+	static_var<int[]> table;
+	table.resize(4096);
+	for (static_var<int> i = 0; i < 4096; i++)
+		table[i] = 0;
+	for (static_var<int> i = 0; i < 200; i++) {
+		buffer[i] = buffer[i] + table[i];
+		if (i % 10 == 0)
+			table[i * 3] = i;
+	}
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		builder::builder_context context;
+		context.extract_function_ast(func, "func");
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	std::cout << name << ": " << ms << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	measure("lookup", lookup, 10);
+	measure("update", update, 10);
+	return 0;
+}
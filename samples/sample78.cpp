@@ -0,0 +1,49 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for tags taken with many dyn_vars alive. Every tag holds the
+// set of the live dyn_vars, the kernel keeps a few hundred of them alive in
+// registers of an unrolled filter
+
+static void filter(dyn_var<int *> in, dyn_var<int *> out, dyn_var<int> n) {
+	std::vector<dyn_var<int> *> taps;
+	for (static_var<int> i = 0; i < 300; i++)
+		taps.push_back(new dyn_var<int>(in[i]));
+	dyn_var<int> j = 0;
+	while (j < n) {
+		dyn_var<int> sum = 0;
+		for (static_var<int> i = 0; i < 300; i++)
+			sum = sum + *taps[i] * in[j + i];
+		out[j] = sum;
+		j = j + 1;
+	}
+	for (auto tap : taps)
+		delete tap;
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		builder::builder_context context;
+		context.extract_function_ast(func, "func");
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	std::cout << name << ": " << ms << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	measure("filter", filter, 5);
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for the hashes of tags. Extracts kernels from the other
+// benchmarks with collect_hash_stats and reports the load of the tables
+// keyed by tags. The last kernels keep a static_var of a type without and
+// with a std::hash. Snapshots of types without one all have the same hash,
+// and the tags that only differ in them collide
+
+static void long_program(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 2000; i++) {
+		sum = sum + buffer[i];
+		if (i % 50 == 0) {
+			if (sum > n)
+				sum = 0;
+		}
+	}
+	buffer[0] = sum;
+}
+
+static void matrix(dyn_var<int *> a, dyn_var<int *> b, dyn_var<int *> c) {
+	for (static_var<int> i = 0; i < 8; i++)
+		for (static_var<int> j = 0; j < 8; j++)
+			c[i * 8 + j] = a[i * 8 + j] * b[j * 8 + i] + c[i * 8 + j];
+}
+
+static void nested(dyn_var<int *> buffer, int depth) {
+	if (depth > 0) {
+		nested(buffer, depth - 1);
+		return;
+	}
+	for (static_var<int> i = 0; i < 50; i++)
+		buffer[i] = buffer[i] + i;
+}
+
+static void deep_stack(dyn_var<int *> buffer) {
+	for (static_var<int> depth = 0; depth < 20; depth++)
+		nested(buffer, depth);
+}
+
+static void filter(dyn_var<int *> in, dyn_var<int *> out, dyn_var<int> n) {
+	std::vector<dyn_var<int> *> taps;
+	for (static_var<int> i = 0; i < 100; i++)
+		taps.push_back(new dyn_var<int>(in[i]));
+	dyn_var<int> j = 0;
+	while (j < n) {
+		dyn_var<int> sum = 0;
+		for (static_var<int> i = 0; i < 100; i++)
+			sum = sum + *taps[i] * in[j + i];
+		out[j] = sum;
+		j = j + 1;
+	}
+	for (auto tap : taps)
+		delete tap;
+}
+
+struct point {
+	int x;
+	int y;
+	bool operator==(const point &other) const {
+		return x == other.x && y == other.y;
+	}
+};
+
+static void unhashable(dyn_var<int *> buffer) {
+	static_var<point> p;
+	// The loop counter isn't a static_var, p is all that tells the 
+	// iterations apart
+	for (int i = 0; i < 500; i++) {
+		p = point{i % 20, i / 20};
+		buffer[p.val.x] = buffer[p.val.y] + 1;
+	}
+}
+
+// The same point with a std::hash
+struct hashed_point {
+	int x;
+	int y;
+	bool operator==(const hashed_point &other) const {
+		return x == other.x && y == other.y;
+	}
+};
+
+namespace std {
+template <>
+struct hash<hashed_point> {
+	size_t operator()(const hashed_point &p) const {
+		return tracer::hash_combine(std::hash<int>{}(p.x), std::hash<int>{}(p.y));
+	}
+};
+} // namespace std
+
+static void hashed(dyn_var<int *> buffer) {
+	static_var<hashed_point> p;
+	for (int i = 0; i < 500; i++) {
+		p = hashed_point{i % 20, i / 20};
+		buffer[p.val.x] = buffer[p.val.y] + 1;
+	}
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	builder::builder_context context;
+	context.collect_stats = true;
+	context.collect_hash_stats = true;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		context.extract_function_ast(func, "func");
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	std::cout << name << ": " << ms << " ms" << std::endl;
+	for (auto &s : context.stats.hash_tables) {
+		std::cout << "  " << s.name << ": " << s.size << " keys, " << s.buckets << " buckets, "
+			  << s.max_bucket_size << " in the largest bucket, " << s.colliding_keys
+			  << " keys with colliding hashes" << std::endl;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	measure("long_program", long_program, 1);
+	measure("matrix", matrix, 20);
+	measure("deep_stack", deep_stack, 5);
+	measure("filter", filter, 5);
+	measure("unhashable", unhashable, 5);
+	measure("hashed", hashed, 5);
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for the heap allocations made while extracting. Counts the
+// calls to operator new for kernels from the other benchmarks, the default
+// operator delete frees with free. Runs that
+// catch up replay the expressions of the run they were forked from, but
+// still build the operands of every operator they pass
+
+static unsigned long long allocations = 0;
+static unsigned long long allocated_bytes = 0;
+
+void *operator new(size_t size) {
+	allocations++;
+	allocated_bytes += size;
+	void *p = std::malloc(size);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+static void long_program(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 2000; i++) {
+		sum = sum + buffer[i];
+		if (i % 50 == 0) {
+			if (sum > n)
+				sum = 0;
+		}
+	}
+	buffer[0] = sum;
+}
+
+static void branches(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 5; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+			if (sum > 100)
+				sum = 0;
+		}
+		sum = sum * 2;
+	}
+	dyn_var<int> j = 0;
+	while (j < n) {
+		if (buffer[j] == sum)
+			break;
+		j = j + 1;
+	}
+	buffer[0] = j;
+}
+
+static void matrix(dyn_var<int *> a, dyn_var<int *> b, dyn_var<int *> c) {
+	for (static_var<int> i = 0; i < 8; i++)
+		for (static_var<int> j = 0; j < 8; j++)
+			c[i * 8 + j] = a[i * 8 + j] * b[j * 8 + i] + c[i * 8 + j];
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	unsigned long long start_allocations = allocations;
+	unsigned long long start_bytes = allocated_bytes;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		builder::builder_context context;
+		context.extract_function_ast(func, "func");
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+	std::cout << name << ": " << ms << " ms, " << (allocations - start_allocations) / iterations
+		  << " allocations, " << (allocated_bytes - start_bytes) / iterations / 1024 << " KB" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	measure("long_program", long_program, 2);
+	measure("branches", branches, 20);
+	measure("matrix", matrix, 20);
+	return 0;
+}
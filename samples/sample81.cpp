@@ -0,0 +1,68 @@
+/*NO_TEST*/
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+#include <map>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::static_var;
+
+// Benchmark for the passes run after the extraction, which test and cast the
+// types of the blocks all the time. Reports the time of every pass with
+// collect_stats. The kernels are a long straight line program with a few
+// branches and a program with many while loops that the loop finders turn
+// into for loops
+
+static void long_program(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 2000; i++) {
+		sum = sum + buffer[i];
+		if (i % 50 == 0) {
+			if (sum > n)
+				sum = 0;
+		}
+	}
+	buffer[0] = sum;
+}
+
+static void loops(dyn_var<int *> buffer, dyn_var<int> n) {
+	for (static_var<int> k = 0; k < 40; k++) {
+		for (dyn_var<int> i = 0; i < n; i = i + 1) {
+			for (dyn_var<int> j = 0; j < n; j = j + 1) {
+				buffer[i * n + j] = buffer[j * n + i] + k;
+				if (buffer[i] > k)
+					buffer[i] = 0;
+			}
+		}
+	}
+}
+
+template <typename F>
+static void measure(std::string name, F func, int iterations) {
+	builder::builder_context context;
+	context.collect_stats = true;
+	double extraction_ms = 0;
+	std::map<std::string, double> pass_ms;
+	for (int i = 0; i < iterations; i++) {
+		context.extract_function_ast(func, "func");
+		extraction_ms += context.stats.extraction_ms;
+		for (auto &p : context.stats.pass_ms)
+			pass_ms[p.first] += p.second;
+	}
+	double total_ms = 0;
+	for (auto &p : pass_ms)
+		total_ms += p.second;
+	std::cout << name << ": extraction " << extraction_ms / iterations << " ms, passes "
+		  << total_ms / iterations << " ms" << std::endl;
+	for (auto &p : pass_ms)
+		std::cout << "  " << p.first << ": " << p.second / iterations << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	measure("long_program", long_program, 3);
+	measure("loops", loops, 3);
+	return 0;
+}
@@ -0,0 +1,34 @@
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+using builder::dyn_var;
+using builder::static_var;
+
+static void blowup(dyn_var<int *> buffer, dyn_var<int> n) {
+	static_var<int> count = 0;
+	for (static_var<int> i = 0; i < 16; i++) {
+		if (buffer[i] > n)
+			count++;
+	}
+	buffer[0] = count;
+}
+static void copies(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 8; i++) {
+		if (buffer[i] > n)
+			sum = sum + buffer[i];
+	}
+	buffer[0] = sum;
+}
+int main() {
+	for (int u = 0; u < 2; u++) {
+	builder::builder_context context;
+	context.collect_stats = true;
+	context.feature_unstructured = u;
+	auto ast = context.extract_function_ast(copies, "copies");
+	std::cout << context.stats.runs << " runs " << context.stats.stmts << std::endl;
+	}
+	builder::builder_context c2; c2.max_runs = 100;
+	try { c2.extract_function_ast(blowup, "blowup"); } catch (builder::ExtractionBudgetException &e) { std::cout << e.what(); }
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+void print_97 (int arg0);
+void print_98 (int arg0);
+void print_99 (int arg0);
+void print_100 (int arg0);
+void print_101 (int arg0);
+void print_102 (int arg0);
+void print_103 (int arg0);
+void print_104 (int arg0);
+void print_105 (int arg0);
+void print_106 (int arg0);
+void print_107 (int arg0);
+void print_108 (int arg0);
+void print_109 (int arg0);
+void print_110 (int arg0);
+void print_111 (int arg0);
+void print_112 (int arg0);
+void print_113 (int arg0);
+void print_114 (int arg0);
+void print_115 (int arg0);
+void print_116 (int arg0);
+void print_117 (int arg0);
+void print_118 (int arg0);
+void print_119 (int arg0);
+void print_120 (int arg0);
+void print_121 (int arg0);
+void print_122 (int arg0);
+void print_97 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 97);
+  }
+  printf("\n");
+  print_98(arg0 + 1);
+}
+
+void print_98 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 98);
+  }
+  printf("\n");
+  print_99(arg0 + 1);
+}
+
+void print_99 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 99);
+  }
+  printf("\n");
+  print_100(arg0 + 1);
+}
+
+void print_100 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 100);
+  }
+  printf("\n");
+  print_101(arg0 + 1);
+}
+
+void print_101 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 101);
+  }
+  printf("\n");
+  print_102(arg0 + 1);
+}
+
+void print_102 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 102);
+  }
+  printf("\n");
+  print_103(arg0 + 1);
+}
+
+void print_103 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 103);
+  }
+  printf("\n");
+  print_104(arg0 + 1);
+}
+
+void print_104 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 104);
+  }
+  printf("\n");
+  print_105(arg0 + 1);
+}
+
+void print_105 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 105);
+  }
+  printf("\n");
+  print_106(arg0 + 1);
+}
+
+void print_106 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 106);
+  }
+  printf("\n");
+  print_107(arg0 + 1);
+}
+
+void print_107 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 107);
+  }
+  printf("\n");
+  print_108(arg0 + 1);
+}
+
+void print_108 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 108);
+  }
+  printf("\n");
+  print_109(arg0 + 1);
+}
+
+void print_109 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 109);
+  }
+  printf("\n");
+  print_110(arg0 + 1);
+}
+
+void print_110 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 110);
+  }
+  printf("\n");
+  print_111(arg0 + 1);
+}
+
+void print_111 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 111);
+  }
+  printf("\n");
+  print_112(arg0 + 1);
+}
+
+void print_112 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 112);
+  }
+  printf("\n");
+  print_113(arg0 + 1);
+}
+
+void print_113 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 113);
+  }
+  printf("\n");
+  print_114(arg0 + 1);
+}
+
+void print_114 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 114);
+  }
+  printf("\n");
+  print_115(arg0 + 1);
+}
+
+void print_115 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 115);
+  }
+  printf("\n");
+  print_116(arg0 + 1);
+}
+
+void print_116 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 116);
+  }
+  printf("\n");
+  print_117(arg0 + 1);
+}
+
+void print_117 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 117);
+  }
+  printf("\n");
+  print_118(arg0 + 1);
+}
+
+void print_118 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 118);
+  }
+  printf("\n");
+  print_119(arg0 + 1);
+}
+
+void print_119 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 119);
+  }
+  printf("\n");
+  print_120(arg0 + 1);
+}
+
+void print_120 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 120);
+  }
+  printf("\n");
+  print_121(arg0 + 1);
+}
+
+void print_121 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 121);
+  }
+  printf("\n");
+  print_122(arg0 + 1);
+}
+
+void print_122 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 122);
+  }
+  printf("\n");
+}
+
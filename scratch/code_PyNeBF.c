@@ -0,0 +1,10 @@
+#include <stdio.h>
+void print_97 (int arg0);
+void print_97 (int arg0) {
+  for (int var0 = 0; var0 < arg0; var0 = var0 + 1) {
+    printf("%c", 97);
+  }
+  printf("\n");
+  print_98(arg0 + 1);
+}
+
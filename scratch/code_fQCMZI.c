@@ -0,0 +1,11 @@
+
+int execute (int arg0) {
+  int var0 = 1;
+  int var1 = arg0;
+  var0 = var0 * var1;
+  var1 = var1 * var1;
+  var1 = var1 * var1;
+  int var2 = var0 * var1;
+  return var2;
+}
+
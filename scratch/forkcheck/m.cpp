@@ -0,0 +1,25 @@
+#include "blocks/c_code_generator.h"
+#include "builder/builder_context.h"
+#include "builder/dyn_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+using builder::dyn_var;
+using builder::static_var;
+
+static void bar(void) {
+	dyn_var<int> k = 0;
+	dyn_var<int> t = 0;
+	while (1) {
+		if (k == 0)
+			break;
+		t = t + 1;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context;
+	context.fork_branches = argc > 1;
+	auto ast = context.extract_ast_from_function(bar);
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	return 0;
+}
@@ -0,0 +1,39 @@
+// Include the headers
+#include "blocks/c_code_generator.h"
+#include "builder/dyn_var.h"
+#include "builder/nd_var.h"
+#include "builder/static_var.h"
+#include <iostream>
+
+// Include the BuildIt types
+using builder::dyn_var;
+using builder::nd_var;
+using builder::static_var;
+
+// The nd_var states are only used on the false side of the branches, the
+// statements extracted on the other paths are kept when the function is
+// extracted again after an update
+static void bar(dyn_var<int *> buffer, dyn_var<int> n) {
+	dyn_var<int> sum = 0;
+	for (static_var<int> i = 0; i < 4; i++) {
+		if (buffer[i] > n) {
+			sum = sum + buffer[i];
+		} else {
+			nd_var<builder::true_top> t;
+			if (i == 2)
+				t.require_val(builder::true_top::T);
+			sum = sum - (int)t.get()->value;
+		}
+	}
+	buffer[0] = sum;
+}
+
+int main(int argc, char *argv[]) {
+	builder::builder_context context; context.reuse_nd_memoization = false;
+	auto ast = context.extract_function_ast(bar, "bar");
+	block::c_code_generator::generate_code(ast, std::cout, 0);
+	for (auto &retry : context.nd_retries)
+		std::cout << "// Retry: " << retry.kept_memoized_tags << " memoized tags kept, "
+			  << retry.dropped_memoized_tags << " dropped, " << retry.runs << " runs" << std::endl;
+	return 0;
+}
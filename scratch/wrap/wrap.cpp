@@ -0,0 +1,7 @@
+#include <execinfo.h>
+#include <cstdio>
+#include <cstdlib>
+static long calls = 0;
+extern "C" int __real_backtrace(void **, int);
+extern "C" int __wrap_backtrace(void **b, int n) { calls++; return __real_backtrace(b, n); }
+struct reporter { ~reporter() { fprintf(stderr, "backtrace calls: %ld\n", calls); } } r;
@@ -1,6 +1,8 @@
 #include "blocks/block.h"
 
 namespace block {
+uint64_t block::current_fork_epoch = 0;
+
 void block::dump(std::ostream &oss, int indent) {
 
 	// No printing for a simple block
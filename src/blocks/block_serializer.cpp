@@ -0,0 +1,698 @@
+#include "blocks/block_serializer.h"
+#include <cstring>
+#include <typeindex>
+
+namespace block {
+
+#define UNARY_EXPR_KINDS(X) X(not_expr) X(unary_minus_expr) X(bitwise_not_expr) X(addr_of_expr)
+
+#define BINARY_EXPR_KINDS(X)                                                                                           \
+	X(and_expr)                                                                                                    \
+	X(bitwise_and_expr)                                                                                            \
+	X(or_expr)                                                                                                     \
+	X(bitwise_or_expr)                                                                                             \
+	X(bitwise_xor_expr)                                                                                            \
+	X(plus_expr)                                                                                                   \
+	X(minus_expr)                                                                                                  \
+	X(mul_expr)                                                                                                    \
+	X(div_expr)                                                                                                    \
+	X(lt_expr)                                                                                                     \
+	X(gt_expr)                                                                                                     \
+	X(lte_expr)                                                                                                    \
+	X(gte_expr)                                                                                                    \
+	X(lshift_expr)                                                                                                 \
+	X(rshift_expr)                                                                                                 \
+	X(equals_expr)                                                                                                 \
+	X(ne_expr)                                                                                                     \
+	X(mod_expr)
+
+#define OTHER_KINDS(X)                                                                                                 \
+	X(cast_expr)                                                                                                   \
+	X(var_expr)                                                                                                    \
+	X(int_const)                                                                                                   \
+	X(double_const)                                                                                                \
+	X(float_const)                                                                                                 \
+	X(string_const)                                                                                                \
+	X(assign_expr)                                                                                                 \
+	X(sq_bkt_expr)                                                                                                 \
+	X(function_call_expr)                                                                                          \
+	X(initializer_list_expr)                                                                                       \
+	X(member_access_expr)                                                                                          \
+	X(expr_stmt)                                                                                                   \
+	X(stmt_block)                                                                                                  \
+	X(decl_stmt)                                                                                                   \
+	X(if_stmt)                                                                                                     \
+	X(case_stmt)                                                                                                   \
+	X(switch_stmt)                                                                                                 \
+	X(label)                                                                                                       \
+	X(label_stmt)                                                                                                  \
+	X(goto_stmt)                                                                                                   \
+	X(while_stmt)                                                                                                  \
+	X(for_stmt)                                                                                                    \
+	X(break_stmt)                                                                                                  \
+	X(continue_stmt)                                                                                               \
+	X(func_decl)                                                                                                   \
+	X(struct_decl)                                                                                                 \
+	X(return_stmt)                                                                                                 \
+	X(var)                                                                                                         \
+	X(scalar_type)                                                                                                 \
+	X(pointer_type)                                                                                                \
+	X(reference_type)                                                                                              \
+	X(function_type)                                                                                               \
+	X(array_type)                                                                                                  \
+	X(builder_var_type)                                                                                            \
+	X(named_type)                                                                                                  \
+	X(anonymous_type)
+
+#define ALL_KINDS(X) UNARY_EXPR_KINDS(X) BINARY_EXPR_KINDS(X) OTHER_KINDS(X)
+
+#define KIND_ENUM(c) kind_##c,
+enum serialized_kind { ALL_KINDS(KIND_ENUM) num_serialized_kinds };
+#undef KIND_ENUM
+
+// How a block is written
+enum block_encoding { null_block = 0, shared_block, written_block, new_block };
+
+// Types of metadata that can be written
+enum metadata_type { bool_metadata = 0, string_vector_metadata };
+
+static int get_block_kind(block::Ptr b) {
+#define KIND_ENTRY(c) {std::type_index(typeid(c)), kind_##c},
+	static const std::unordered_map<std::type_index, int> kinds = {ALL_KINDS(KIND_ENTRY)};
+#undef KIND_ENTRY
+	auto it = kinds.find(std::type_index(typeid(*b)));
+	if (it == kinds.end())
+		return -1;
+	return it->second;
+}
+
+static block::Ptr create_block(int kind) {
+	switch (kind) {
+#define KIND_CREATE(c)                                                                                                 \
+	case kind_##c:                                                                                                 \
+		return std::make_shared<c>();
+		ALL_KINDS(KIND_CREATE)
+#undef KIND_CREATE
+	default:
+		return nullptr;
+	}
+}
+
+void block_writer::write_u64(uint64_t v) {
+	write_bytes(&v, sizeof(v));
+}
+void block_writer::write_bytes(const void *p, size_t size) {
+	buffer.append((const char *)p, size);
+}
+void block_writer::write_string(const std::string &s) {
+	write_u64(s.size());
+	buffer.append(s);
+}
+
+void block_writer::write_tag(const tracer::tag &t) {
+	std::vector<unsigned long long> pointers = t.get_pointers();
+	write_u64(pointers.size());
+	for (auto p : pointers)
+		write_u64(p);
+
+	write_u64(t.static_var_snapshots.size());
+	for (auto snapshot : t.static_var_snapshots) {
+		if (snapshot == nullptr) {
+			write_u64(0);
+			continue;
+		}
+		std::string bytes;
+		if (!snapshot->to_bytes(bytes))
+			failed = true;
+		// Both processes run the same binary, so the function creating the
+		// snapshot back is at the same address
+		write_u64((uint64_t)(uintptr_t)snapshot->get_from_bytes());
+		write_string(bytes);
+	}
+
+	write_u64(t.static_var_key_values.size());
+	for (auto &kv : t.static_var_key_values) {
+		write_string(kv.first);
+		write_string(kv.second);
+	}
+
+	static const std::vector<tracer::tag_id> no_live_dyn_vars;
+	auto &live_dyn_vars = t.live_dyn_vars != nullptr ? t.live_dyn_vars->ids : no_live_dyn_vars;
+	write_u64(live_dyn_vars.size());
+	for (auto id : live_dyn_vars)
+		write_u64(id);
+	write_u64(t.dedup_id);
+}
+
+static bool is_known_metadata(block_metadata::Ptr md) {
+	return md->isa<bool>() || md->isa<std::vector<std::string>>();
+}
+
+void block_writer::write_metadata(block::Ptr b, bool skip_unknown) {
+	uint64_t count = 0;
+	for (auto &md : b->metadata_map)
+		if (!skip_unknown || is_known_metadata(md.second))
+			count++;
+	write_u64(count);
+	for (auto &md : b->metadata_map) {
+		if (skip_unknown && !is_known_metadata(md.second))
+			continue;
+		write_string(md.first);
+		if (md.second->isa<bool>()) {
+			write_u64(bool_metadata);
+			write_u64(md.second->to<bool>()->val);
+		} else if (md.second->isa<std::vector<std::string>>()) {
+			write_u64(string_vector_metadata);
+			auto &strs = md.second->to<std::vector<std::string>>()->val;
+			write_u64(strs.size());
+			for (auto &s : strs)
+				write_string(s);
+		} else {
+			failed = true;
+		}
+	}
+}
+
+void block_writer::write_block(block::Ptr b) {
+	if (b == nullptr) {
+		write_u64(null_block);
+		return;
+	}
+	auto it = written_ids.find(b.get());
+	if (it != written_ids.end()) {
+		write_u64(written_block);
+		write_u64(it->second);
+		return;
+	}
+	uint64_t id = written_ids.size();
+	written_ids[b.get()] = id;
+	if (b->fork_epoch < shared_epoch) {
+		write_u64(shared_block);
+		write_u64((uint64_t)(uintptr_t)b.get());
+		// Blocks that existed before the fork can still be updated after
+		// it. Runs add attributes to vars and merging branches can replace
+		// the condition of an if statement
+		write_metadata(b, true);
+		if (isa<if_stmt>(b))
+			write_block(to<if_stmt>(b)->cond);
+		return;
+	}
+	int kind = get_block_kind(b);
+	if (kind < 0) {
+		failed = true;
+		write_u64(null_block);
+		return;
+	}
+
+	write_u64(new_block);
+	write_u64(kind);
+	write_tag(b->static_offset);
+	write_metadata(b, false);
+	if (isa<stmt>(b)) {
+		auto &annotation = to<stmt>(b)->annotation;
+		write_u64(annotation.size());
+		for (auto &a : annotation)
+			write_string(a);
+	}
+	if (isa<type>(b)) {
+		write_u64(to<type>(b)->is_const);
+		write_u64(to<type>(b)->is_volatile);
+	}
+	write_fields(kind, b);
+}
+
+template <typename T>
+static void write_block_vector(block_writer *w, const std::vector<std::shared_ptr<T>> &v) {
+	w->write_u64(v.size());
+	for (auto b : v)
+		w->write_block(b);
+}
+
+void block_writer::write_fields(int kind, block::Ptr b) {
+	switch (kind) {
+#define UNARY_CASE(c) case kind_##c:
+		UNARY_EXPR_KINDS(UNARY_CASE)
+#undef UNARY_CASE
+		write_block(to<unary_expr>(b)->expr1);
+		break;
+#define BINARY_CASE(c) case kind_##c:
+		BINARY_EXPR_KINDS(BINARY_CASE)
+#undef BINARY_CASE
+		write_block(to<binary_expr>(b)->expr1);
+		write_block(to<binary_expr>(b)->expr2);
+		break;
+	case kind_cast_expr:
+		write_block(to<cast_expr>(b)->expr1);
+		write_block(to<cast_expr>(b)->type1);
+		break;
+	case kind_var_expr:
+		write_block(to<var_expr>(b)->var1);
+		write_block_vector(this, to<var_expr>(b)->template_args);
+		break;
+	case kind_int_const:
+		write_u64(to<int_const>(b)->value);
+		write_u64(to<int_const>(b)->is_64bit);
+		break;
+	case kind_double_const:
+		write_bytes(&to<double_const>(b)->value, sizeof(double));
+		break;
+	case kind_float_const:
+		write_bytes(&to<float_const>(b)->value, sizeof(float));
+		break;
+	case kind_string_const:
+		write_string(to<string_const>(b)->value);
+		break;
+	case kind_assign_expr:
+		write_block(to<assign_expr>(b)->var1);
+		write_block(to<assign_expr>(b)->expr1);
+		break;
+	case kind_sq_bkt_expr:
+		write_block(to<sq_bkt_expr>(b)->var_expr);
+		write_block(to<sq_bkt_expr>(b)->index);
+		break;
+	case kind_function_call_expr:
+		write_block(to<function_call_expr>(b)->expr1);
+		write_block_vector(this, to<function_call_expr>(b)->args);
+		break;
+	case kind_initializer_list_expr:
+		write_block_vector(this, to<initializer_list_expr>(b)->elems);
+		break;
+	case kind_member_access_expr:
+		write_block(to<member_access_expr>(b)->parent_expr);
+		write_string(to<member_access_expr>(b)->member_name);
+		break;
+	case kind_expr_stmt:
+		write_block(to<expr_stmt>(b)->expr1);
+		write_u64(to<expr_stmt>(b)->mark_for_deletion);
+		break;
+	case kind_stmt_block:
+		write_block_vector(this, to<stmt_block>(b)->stmts);
+		break;
+	case kind_decl_stmt:
+		write_block(to<decl_stmt>(b)->decl_var);
+		write_block(to<decl_stmt>(b)->init_expr);
+		write_u64(to<decl_stmt>(b)->is_extern);
+		write_u64(to<decl_stmt>(b)->is_static);
+		break;
+	case kind_if_stmt:
+		write_block(to<if_stmt>(b)->cond);
+		write_block(to<if_stmt>(b)->then_stmt);
+		write_block(to<if_stmt>(b)->else_stmt);
+		break;
+	case kind_case_stmt:
+		write_u64(to<case_stmt>(b)->is_default);
+		write_block(to<case_stmt>(b)->case_value);
+		write_block(to<case_stmt>(b)->branch);
+		break;
+	case kind_switch_stmt:
+		write_block(to<switch_stmt>(b)->cond);
+		write_block_vector(this, to<switch_stmt>(b)->cases);
+		break;
+	case kind_label:
+		write_string(to<label>(b)->label_name);
+		break;
+	case kind_label_stmt:
+		write_block(to<label_stmt>(b)->label1);
+		break;
+	case kind_goto_stmt:
+		write_block(to<goto_stmt>(b)->label1);
+		write_tag(to<goto_stmt>(b)->temporary_label_number);
+		break;
+	case kind_while_stmt:
+		write_block(to<while_stmt>(b)->body);
+		write_block(to<while_stmt>(b)->cond);
+		write_block_vector(this, to<while_stmt>(b)->continue_blocks);
+		break;
+	case kind_for_stmt:
+		write_block(to<for_stmt>(b)->decl_stmt);
+		write_block(to<for_stmt>(b)->cond);
+		write_block(to<for_stmt>(b)->update);
+		write_block(to<for_stmt>(b)->body);
+		break;
+	case kind_break_stmt:
+	case kind_continue_stmt:
+		break;
+	case kind_func_decl:
+		write_string(to<func_decl>(b)->func_name);
+		write_block(to<func_decl>(b)->return_type);
+		write_block_vector(this, to<func_decl>(b)->args);
+		write_block(to<func_decl>(b)->body);
+		write_u64(to<func_decl>(b)->is_decl_only);
+		write_u64(to<func_decl>(b)->is_variadic);
+		write_u64(to<func_decl>(b)->is_static);
+		write_u64(to<func_decl>(b)->is_inline);
+		break;
+	case kind_struct_decl:
+		write_string(to<struct_decl>(b)->struct_name);
+		write_block_vector(this, to<struct_decl>(b)->members);
+		write_u64(to<struct_decl>(b)->is_union);
+		write_u64(to<struct_decl>(b)->is_decl_only);
+		break;
+	case kind_return_stmt:
+		write_block(to<return_stmt>(b)->return_val);
+		break;
+	case kind_var:
+		write_string(to<var>(b)->var_name);
+		write_string(to<var>(b)->preferred_name);
+		write_block(to<var>(b)->var_type);
+		break;
+	case kind_scalar_type:
+		write_u64(to<scalar_type>(b)->scalar_type_id);
+		break;
+	case kind_pointer_type:
+		write_block(to<pointer_type>(b)->pointee_type);
+		break;
+	case kind_reference_type:
+		write_block(to<reference_type>(b)->referenced_type);
+		break;
+	case kind_function_type:
+		write_block(to<function_type>(b)->return_type);
+		write_block_vector(this, to<function_type>(b)->arg_types);
+		write_u64(to<function_type>(b)->is_variadic);
+		break;
+	case kind_array_type:
+		write_block(to<array_type>(b)->element_type);
+		write_u64(to<array_type>(b)->size);
+		break;
+	case kind_builder_var_type:
+		write_u64(to<builder_var_type>(b)->builder_var_type_id);
+		write_block(to<builder_var_type>(b)->closure_type);
+		break;
+	case kind_named_type:
+		write_string(to<named_type>(b)->type_name);
+		write_block_vector(this, to<named_type>(b)->template_args);
+		break;
+	case kind_anonymous_type:
+		write_block(to<anonymous_type>(b)->ref_type);
+		break;
+	}
+}
+
+uint64_t block_reader::read_u64(void) {
+	uint64_t v = 0;
+	read_bytes(&v, sizeof(v));
+	return v;
+}
+void block_reader::read_bytes(void *p, size_t size) {
+	if (failed || offset + size > buffer.size()) {
+		failed = true;
+		memset(p, 0, size);
+		return;
+	}
+	memcpy(p, buffer.data() + offset, size);
+	offset += size;
+}
+std::string block_reader::read_string(void) {
+	uint64_t size = read_u64();
+	if (failed || offset + size > buffer.size()) {
+		failed = true;
+		return "";
+	}
+	std::string s = buffer.substr(offset, size);
+	offset += size;
+	return s;
+}
+
+tracer::tag block_reader::read_tag(void) {
+	tracer::tag t;
+	std::vector<unsigned long long> pointers;
+	uint64_t n = read_u64();
+	for (uint64_t i = 0; i < n && !failed; i++)
+		pointers.push_back(read_u64());
+	if (trie != nullptr)
+		t.stack = trie->intern(pointers.data(), pointers.size());
+	else
+		t.stack = tracer::make_call_stack(pointers);
+
+	n = read_u64();
+	for (uint64_t i = 0; i < n && !failed; i++) {
+		uint64_t from_bytes = read_u64();
+		if (from_bytes == 0) {
+			t.static_var_snapshots.push_back(nullptr);
+			continue;
+		}
+		std::string bytes = read_string();
+		if (failed)
+			break;
+		auto create = (builder::static_var_snapshot_base::from_bytes_t)(uintptr_t)from_bytes;
+		builder::static_var_snapshot_base::Ptr snapshot = create(bytes);
+		if (snapshot == nullptr)
+			failed = true;
+		t.static_var_snapshots.push_back(snapshot);
+	}
+
+	n = read_u64();
+	for (uint64_t i = 0; i < n && !failed; i++) {
+		std::string key = read_string();
+		std::string value = read_string();
+		t.static_var_key_values.push_back({key, value});
+	}
+
+	n = read_u64();
+	std::vector<tracer::tag_id> live_dyn_vars;
+	for (uint64_t i = 0; i < n && !failed; i++)
+		live_dyn_vars.push_back(read_u64());
+	t.live_dyn_vars = tracer::make_live_var_set(live_dyn_vars);
+	t.dedup_id = read_u64();
+	return t;
+}
+
+void block_reader::read_metadata(block::Ptr b) {
+	uint64_t n = read_u64();
+	for (uint64_t i = 0; i < n && !failed; i++) {
+		std::string name = read_string();
+		uint64_t md_type = read_u64();
+		if (md_type == bool_metadata) {
+			b->setMetadata<bool>(name, read_u64());
+		} else if (md_type == string_vector_metadata) {
+			std::vector<std::string> strs;
+			uint64_t count = read_u64();
+			for (uint64_t j = 0; j < count && !failed; j++)
+				strs.push_back(read_string());
+			b->setMetadata<std::vector<std::string>>(name, strs);
+		} else {
+			failed = true;
+		}
+	}
+}
+
+block::Ptr block_reader::read_block(void) {
+	uint64_t encoding = read_u64();
+	if (failed)
+		return nullptr;
+	if (encoding == null_block)
+		return nullptr;
+	if (encoding == shared_block) {
+		block *shared = (block *)(uintptr_t)read_u64();
+		if (failed)
+			return nullptr;
+		block::Ptr b = shared->shared_from_this();
+		read_blocks.push_back(b);
+		read_metadata(b);
+		if (isa<if_stmt>(b)) {
+			expr::Ptr cond = read_block_as<expr>();
+			if (!failed)
+				to<if_stmt>(b)->cond = cond;
+		}
+		return b;
+	}
+	if (encoding == written_block) {
+		uint64_t id = read_u64();
+		if (failed || id >= read_blocks.size()) {
+			failed = true;
+			return nullptr;
+		}
+		return read_blocks[id];
+	}
+	int kind = read_u64();
+	block::Ptr b = create_block(kind);
+	if (b == nullptr) {
+		failed = true;
+		return nullptr;
+	}
+	read_blocks.push_back(b);
+
+	b->static_offset = read_tag();
+	read_metadata(b);
+	if (isa<stmt>(b)) {
+		uint64_t n = read_u64();
+		for (uint64_t i = 0; i < n && !failed; i++)
+			to<stmt>(b)->annotation.insert(read_string());
+	}
+	if (isa<type>(b)) {
+		to<type>(b)->is_const = read_u64();
+		to<type>(b)->is_volatile = read_u64();
+	}
+	read_fields(kind, b);
+	return b;
+}
+
+template <typename T>
+static void read_block_vector(block_reader *r, std::vector<std::shared_ptr<T>> &v) {
+	uint64_t n = r->read_u64();
+	for (uint64_t i = 0; i < n && !r->failed; i++)
+		v.push_back(r->read_block_as<T>());
+}
+
+void block_reader::read_fields(int kind, block::Ptr b) {
+	switch (kind) {
+#define UNARY_CASE(c) case kind_##c:
+		UNARY_EXPR_KINDS(UNARY_CASE)
+#undef UNARY_CASE
+		to<unary_expr>(b)->expr1 = read_block_as<expr>();
+		break;
+#define BINARY_CASE(c) case kind_##c:
+		BINARY_EXPR_KINDS(BINARY_CASE)
+#undef BINARY_CASE
+		to<binary_expr>(b)->expr1 = read_block_as<expr>();
+		to<binary_expr>(b)->expr2 = read_block_as<expr>();
+		break;
+	case kind_cast_expr:
+		to<cast_expr>(b)->expr1 = read_block_as<expr>();
+		to<cast_expr>(b)->type1 = read_block_as<type>();
+		break;
+	case kind_var_expr:
+		to<var_expr>(b)->var1 = read_block_as<var>();
+		read_block_vector(this, to<var_expr>(b)->template_args);
+		break;
+	case kind_int_const:
+		to<int_const>(b)->value = read_u64();
+		to<int_const>(b)->is_64bit = read_u64();
+		break;
+	case kind_double_const:
+		read_bytes(&to<double_const>(b)->value, sizeof(double));
+		break;
+	case kind_float_const:
+		read_bytes(&to<float_const>(b)->value, sizeof(float));
+		break;
+	case kind_string_const:
+		to<string_const>(b)->value = read_string();
+		break;
+	case kind_assign_expr:
+		to<assign_expr>(b)->var1 = read_block_as<expr>();
+		to<assign_expr>(b)->expr1 = read_block_as<expr>();
+		break;
+	case kind_sq_bkt_expr:
+		to<sq_bkt_expr>(b)->var_expr = read_block_as<expr>();
+		to<sq_bkt_expr>(b)->index = read_block_as<expr>();
+		break;
+	case kind_function_call_expr:
+		to<function_call_expr>(b)->expr1 = read_block_as<expr>();
+		read_block_vector(this, to<function_call_expr>(b)->args);
+		break;
+	case kind_initializer_list_expr:
+		read_block_vector(this, to<initializer_list_expr>(b)->elems);
+		break;
+	case kind_member_access_expr:
+		to<member_access_expr>(b)->parent_expr = read_block_as<expr>();
+		to<member_access_expr>(b)->member_name = read_string();
+		break;
+	case kind_expr_stmt:
+		to<expr_stmt>(b)->expr1 = read_block_as<expr>();
+		to<expr_stmt>(b)->mark_for_deletion = read_u64();
+		break;
+	case kind_stmt_block:
+		read_block_vector(this, to<stmt_block>(b)->stmts);
+		break;
+	case kind_decl_stmt:
+		to<decl_stmt>(b)->decl_var = read_block_as<var>();
+		to<decl_stmt>(b)->init_expr = read_block_as<expr>();
+		to<decl_stmt>(b)->is_extern = read_u64();
+		to<decl_stmt>(b)->is_static = read_u64();
+		break;
+	case kind_if_stmt:
+		to<if_stmt>(b)->cond = read_block_as<expr>();
+		to<if_stmt>(b)->then_stmt = read_block_as<stmt>();
+		to<if_stmt>(b)->else_stmt = read_block_as<stmt>();
+		break;
+	case kind_case_stmt:
+		to<case_stmt>(b)->is_default = read_u64();
+		to<case_stmt>(b)->case_value = read_block_as<int_const>();
+		to<case_stmt>(b)->branch = read_block_as<stmt>();
+		break;
+	case kind_switch_stmt:
+		to<switch_stmt>(b)->cond = read_block_as<expr>();
+		read_block_vector(this, to<switch_stmt>(b)->cases);
+		break;
+	case kind_label:
+		to<label>(b)->label_name = read_string();
+		break;
+	case kind_label_stmt:
+		to<label_stmt>(b)->label1 = read_block_as<label>();
+		break;
+	case kind_goto_stmt:
+		to<goto_stmt>(b)->label1 = read_block_as<label>();
+		to<goto_stmt>(b)->temporary_label_number = read_tag();
+		break;
+	case kind_while_stmt:
+		to<while_stmt>(b)->body = read_block_as<stmt>();
+		to<while_stmt>(b)->cond = read_block_as<expr>();
+		read_block_vector(this, to<while_stmt>(b)->continue_blocks);
+		break;
+	case kind_for_stmt:
+		to<for_stmt>(b)->decl_stmt = read_block_as<stmt>();
+		to<for_stmt>(b)->cond = read_block_as<expr>();
+		to<for_stmt>(b)->update = read_block_as<expr>();
+		to<for_stmt>(b)->body = read_block_as<stmt>();
+		break;
+	case kind_break_stmt:
+	case kind_continue_stmt:
+		break;
+	case kind_func_decl:
+		to<func_decl>(b)->func_name = read_string();
+		to<func_decl>(b)->return_type = read_block_as<type>();
+		read_block_vector(this, to<func_decl>(b)->args);
+		to<func_decl>(b)->body = read_block_as<stmt>();
+		to<func_decl>(b)->is_decl_only = read_u64();
+		to<func_decl>(b)->is_variadic = read_u64();
+		to<func_decl>(b)->is_static = read_u64();
+		to<func_decl>(b)->is_inline = read_u64();
+		break;
+	case kind_struct_decl:
+		to<struct_decl>(b)->struct_name = read_string();
+		read_block_vector(this, to<struct_decl>(b)->members);
+		to<struct_decl>(b)->is_union = read_u64();
+		to<struct_decl>(b)->is_decl_only = read_u64();
+		break;
+	case kind_return_stmt:
+		to<return_stmt>(b)->return_val = read_block_as<expr>();
+		break;
+	case kind_var:
+		to<var>(b)->var_name = read_string();
+		to<var>(b)->preferred_name = read_string();
+		to<var>(b)->var_type = read_block_as<type>();
+		break;
+	case kind_scalar_type:
+		to<scalar_type>(b)->scalar_type_id = (decltype(scalar_type::scalar_type_id))read_u64();
+		break;
+	case kind_pointer_type:
+		to<pointer_type>(b)->pointee_type = read_block_as<type>();
+		break;
+	case kind_reference_type:
+		to<reference_type>(b)->referenced_type = read_block_as<type>();
+		break;
+	case kind_function_type:
+		to<function_type>(b)->return_type = read_block_as<type>();
+		read_block_vector(this, to<function_type>(b)->arg_types);
+		to<function_type>(b)->is_variadic = read_u64();
+		break;
+	case kind_array_type:
+		to<array_type>(b)->element_type = read_block_as<type>();
+		to<array_type>(b)->size = read_u64();
+		break;
+	case kind_builder_var_type:
+		to<builder_var_type>(b)->builder_var_type_id =
+		    (decltype(builder_var_type::builder_var_type_id))read_u64();
+		to<builder_var_type>(b)->closure_type = read_block_as<type>();
+		break;
+	case kind_named_type:
+		to<named_type>(b)->type_name = read_string();
+		read_block_vector(this, to<named_type>(b)->template_args);
+		break;
+	case kind_anonymous_type:
+		to<anonymous_type>(b)->ref_type = read_block();
+		break;
+	}
+}
+
+} // namespace block
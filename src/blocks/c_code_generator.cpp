@@ -14,7 +14,7 @@ void c_code_generator::save_static_info(block::Ptr a) {
 	for (auto &keyval : a->static_offset.static_var_key_values) {
 		xctx.set_var_here(keyval.first, keyval.second);
 	}
-	for (auto &addr : a->static_offset.pointers) {
+	for (auto &addr : a->static_offset.get_pointers()) {
 		int line_no = -1;
 		const char *filename = NULL;
 		std::string function_name, linkage_name;
@@ -8,10 +8,19 @@
 #include "blocks/sub_expr_cleanup.h"
 #include "blocks/generic_checker.h"
 #include "blocks/var_namer.h"
+#include "blocks/block_serializer.h"
 #include "builder/dyn_var.h"
 #include "builder/exceptions.h"
 #include "util/tracer.h"
+#include "util/run_boundary.h"
+#include "util/work_stealing_pool.h"
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace builder {
 
@@ -184,61 +193,156 @@ void builder_context::extract_function_ast_impl(invocation_state* i_state) {
 		assert(false && "D2X support cannot be enabled without the ENABLE_D2X build option");
 #endif
 	block::stmt::Ptr ast = nullptr;
+
+	// Set up the pool and per thread arenas if runs are to be extracted in parallel
+	std::unique_ptr<utils::work_stealing_pool> pool;
+	if (extraction_threads > 1) {
+		i_state->worker_arenas.clear();
+		for (unsigned int i = 1; i < extraction_threads; i++)
+			i_state->worker_arenas.push_back(std::unique_ptr<dyn_var_arena>(new dyn_var_arena()));
+		pool.reset(new utils::work_stealing_pool(extraction_threads));
+	}
+
+	if (collect_stats) {
+		stats = extraction_stats();
+		stats.func_name = i_state->generated_func_decl->func_name;
+	}
+	pass_timer timer(collect_stats ? &stats : nullptr);
+
+	bool fork_failed = false;
+	bool budget_exceeded = false;
+	nd_retries.clear();
+	i_state->updated_nd_states.clear();
+	i_state->extraction_start = std::chrono::steady_clock::now();
+	i_state->previous_runs = i_state->previous_stmts = 0;
+	// The attempt that ended on an nd_var update
+	std::unique_ptr<execution_state> failed_state;
 	// Repeat till ND vars are happy
 	while (1) {
+		// Allocate one execution_state for this ND run
+		std::unique_ptr<execution_state> e_state(new execution_state(i_state));
+		e_state->pool = pool.get();
+		if (failed_state != nullptr) {
+			nd_retry retry;
+			if (reuse_nd_memoization && !feature_unstructured)
+				retry.kept_memoized_tags = e_state->reuse_memoization(*failed_state, i_state->updated_nd_states);
+			retry.dropped_memoized_tags = failed_state->memoized_tags.size() - retry.kept_memoized_tags;
+			nd_retries.push_back(retry);
+			i_state->previous_runs += failed_state->run_count;
+			i_state->previous_stmts += failed_state->stmt_count;
+			e_state->branch_counts = std::move(failed_state->branch_counts);
+			failed_state = nullptr;
+			i_state->updated_nd_states.clear();
+		}
 		try {
-			// Allocate one execution_state for this ND run
-			execution_state e_state (i_state);
-			// Allocate one run_state, rest will be allocated by the recursive calls
-			run_state r_state (&e_state, i_state);
-			ast = extract_ast_from_run(&r_state);
+			// Allocate one run_state, rest will be allocated while exploring the branches
+			run_state r_state (e_state.get(), i_state);
+			// The parallel extraction forks and joins runs recursively
+			if (pool != nullptr) {
+				ast = extract_ast_from_run(&r_state);
+			} else {
+				ast = nullptr;
+				if (fork_branches && !fork_failed) {
+					ast = extract_ast_from_forks(&r_state);
+					// Runs are replayed from here on if the forked 
+					// processes couldn't extract the function
+					fork_failed = (ast == nullptr);
+				}
+				if (ast == nullptr)
+					ast = extract_ast_from_worklist(&r_state);
+			}
 		} catch (NonDeterministicFailureException &e) {
-			continue;
+			failed_state = std::move(e_state);
+		} catch (ExtractionBudgetException &e) {
+			if (!budget_fallback_unstructured || feature_unstructured)
+				throw;
+			budget_exceeded = true;
+		}
+		if (!nd_retries.empty())
+			nd_retries.back().runs = (failed_state != nullptr ? failed_state : e_state)->run_count;
+		if (collect_stats)
+			add_execution_stats(failed_state != nullptr ? failed_state.get() : e_state.get());
+		if (failed_state == nullptr)
+			break;
+	}
+	if (budget_exceeded) {
+		// Memoization hits only add a goto without feature_unstructured
+		feature_unstructured = true;
+		try {
+			extract_function_ast_impl(i_state);
+		} catch (...) {
+			feature_unstructured = false;
+			throw;
+		}
+		feature_unstructured = false;
+		return;
+	}
+	if (collect_stats) {
+		stats.extraction_ms = timer.lap();
+		stats.nd_failures = nd_retries.size();
+		stats.tags_created = i_state->tag_factory_instance.size();
+		stats.nd_states = i_state->nd_state_map.size();
+		if (collect_hash_stats) {
+			stats.hash_tables.push_back(measure_hash_table("tag_factory", i_state->tag_factory_instance.internal_map));
+			stats.hash_tables.push_back(measure_hash_table("nd_states", i_state->nd_state_map));
+			stats.hash_tables.push_back(measure_hash_table("call_stacks", i_state->call_stack_trie_instance.children));
+			stats.hash_tables.push_back(
+			    measure_hash_table("live_var_transitions", i_state->live_var_table_instance.transitions));
 		}
-		break;
 	}
 
 	// Before making any changes, untangle the whole AST
 	ast = clone(ast);
+	timer.end_pass("clone");
 	
 	// Make sure any generics haven't been left 
 	// unspecialized
 	block::generic_null_checker checker;
 	ast->accept(&checker);
+	timer.end_pass("generic_null_checker");
 
 	block::var_namer::name_vars(ast);
+	timer.end_pass("var_namer");
 
 	block::label_collector collector;
 	ast->accept(&collector);
+	timer.end_pass("label_collector");
 
 	block::label_creator creator;
 	creator.collected_labels = collector.collected_labels;
 	ast->accept(&creator);
+	timer.end_pass("label_creator");
 
 	block::label_inserter inserter;
 	inserter.backup_offset_to_label = creator.offset_to_label;
 	inserter.feature_unstructured = feature_unstructured;
 	ast->accept(&inserter);
+	timer.end_pass("label_inserter");
 
 	// At this point it is safe to remove statements that are
 	// marked for deletion
 	block::sub_expr_cleanup cleaner;
 	ast->accept(&cleaner);
+	timer.end_pass("sub_expr_cleanup");
 
 	if (!feature_unstructured) {
 
 		block::basic_block::cfg_block BBs = generate_basic_blocks(block::to<block::stmt_block>(ast));
+		timer.end_pass("basic_blocks");
 		
 		block::loop_finder finder;
 		finder.ast = ast;
 		ast->accept(&finder);
+		timer.end_pass("loop_finder");
 
 		block::if_switcher switcher;
 		ast->accept(&switcher);
+		timer.end_pass("if_switcher");
 
 		block::for_loop_finder for_finder;
 		for_finder.ast = ast;
 		ast->accept(&for_finder);
+		timer.end_pass("for_loop_finder");
 	}
 
 
@@ -248,17 +352,72 @@ void builder_context::extract_function_ast_impl(invocation_state* i_state) {
 	// since it has to consider the worst case
 	if (run_rce) {
 		block::eliminate_redundant_vars(ast);
+		timer.end_pass("rce");
 	}
 
 	block::loop_roll_finder loop_roll_finder;
 	ast->accept(&loop_roll_finder);
+	timer.end_pass("loop_roll_finder");
 
 
 	i_state->generated_func_decl->body = ast;	
 }
-block::stmt::Ptr builder_context::extract_ast_from_run(run_state* r_state) {
+static void update_max(std::atomic<size_t> &max, size_t value) {
+	size_t current = max;
+	while (current < value && !max.compare_exchange_weak(current, value))
+		;
+}
+
+void builder_context::add_execution_stats(execution_state *e_state) {
+	stats.runs += e_state->run_count;
+	stats.out_of_bools += e_state->out_of_bools_count;
+	stats.loop_backs += e_state->loop_back_count;
+	stats.memoization_hits += e_state->memoization_count;
+	stats.stmts += e_state->stmt_count;
+	stats.max_bool_vector_depth = std::max<size_t>(stats.max_bool_vector_depth, e_state->max_bool_vector_size);
+	stats.max_visited_offsets = std::max<size_t>(stats.max_visited_offsets, e_state->max_visited_offsets);
+	stats.memoized_tags = e_state->memoized_tags.size();
+}
+
+void builder_context::check_budgets(run_state *r_state) {
+	execution_state *e_state = r_state->e_state;
+	invocation_state *i_state = r_state->i_state;
+	std::string exceeded;
+	size_t runs = i_state->previous_runs + e_state->run_count;
+	size_t stmts = i_state->previous_stmts + e_state->stmt_count;
+	if (max_runs != 0 && runs >= max_runs) {
+		exceeded = "max_runs " + std::to_string(max_runs);
+	} else if (max_stmts != 0 && stmts > max_stmts) {
+		exceeded = "max_stmts " + std::to_string(max_stmts) + " with " + std::to_string(stmts) + " statements";
+	} else if (max_extraction_ms != 0) {
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+								      i_state->extraction_start).count();
+		if (ms > max_extraction_ms)
+			exceeded = "max_extraction_ms " + std::to_string(max_extraction_ms);
+	}
+	if (exceeded.empty())
+		return;
+
+	std::vector<std::pair<size_t, tracer::tag>> branches;
+	{
+		auto lock = e_state->lock_shared_state();
+		for (auto &b : e_state->branch_counts)
+			branches.push_back({b.second, b.first});
+	}
+	std::sort(branches.begin(), branches.end(),
+		  [](const std::pair<size_t, tracer::tag> &a, const std::pair<size_t, tracer::tag> &b) {
+			  return a.first > b.first;
+		  });
+	std::string message = "Extraction of " + i_state->generated_func_decl->func_name + " exceeded " + exceeded +
+			      " after " + std::to_string(runs) + " runs. Branches explored most often:\n";
+	for (unsigned int i = 0; i < branches.size() && i < 5; i++)
+		message += "  " + branches[i].second.stringify_loc() + " " + std::to_string(branches[i].first) + " times\n";
+	throw ExtractionBudgetException(message);
+}
+
+block::expr_stmt::Ptr builder_context::execute_run(run_state* r_state, tracer::tag& branch_offset,
+						   std::unique_lock<std::mutex>& memo_lock) {
 	r_state->current_stmt_block = std::make_shared<block::stmt_block>();
-	block::stmt_block::Ptr ast = r_state->current_stmt_block;
 
 	// A new run is starting, clear the parent stack
 	// for identifying nested members. This is because a run can end mid construction
@@ -266,116 +425,152 @@ block::stmt::Ptr builder_context::extract_ast_from_run(run_state* r_state) {
 		parents_stack->clear();
 	}
 
-	block::stmt_block::Ptr ret_ast;
-
-	std::vector<bool> bool_vector_copy = r_state->bool_vector;
-
+	execution_state *e_state = r_state->e_state;
+	if (has_budgets())
+		check_budgets(r_state);
+	e_state->run_count++;
+	update_max(e_state->max_bool_vector_size, r_state->bool_vector.size());
+	run_exit run_end;
 	try {
 		run_state::current_run_state = r_state;
-		// function();
-		lambda_wrapper(r_state->i_state->invocation_function);
-		r_state->commit_uncommitted();
-		ret_ast = ast;
-		get_invocation_state()->get_arena()->reset_arena();
-		run_state::current_run_state = nullptr;
-
+		auto run = [&]() {
+			// function();
+			r_state->stack_top = __builtin_frame_address(0);
+			lambda_wrapper(r_state->i_state->invocation_function);
+			r_state->commit_uncommitted();
+		};
+		if (exit_mode == run_exit_mode::forced_unwind) {
+			utils::run_boundary boundary;
+			r_state->exit_boundary = &boundary;
+			bool exited = utils::run_under_boundary(&boundary, run);
+			r_state->exit_boundary = nullptr;
+			if (exited)
+				run_end = std::move(r_state->pending_exit);
+		} else {
+			run();
+		}
 	} catch (OutOfBoolsException &e) {
+		run_end.kind = run_exit::exit_kind::out_of_bools;
+		run_end.static_offset = e.static_offset;
+	} catch (LoopBackException &e) {
+		run_end.kind = run_exit::exit_kind::loop_back;
+		run_end.static_offset = e.static_offset;
+	} catch (MemoizationException &e) {
+		run_end.kind = run_exit::exit_kind::memoization;
+		run_end.static_offset = e.static_offset;
+		run_end.parent = e.parent;
+		run_end.child_id = e.child_id;
+	}
 
-		// Reset dyn_var arena before starting new runs
-		get_invocation_state()->get_arena()->reset_arena();
-
-		run_state::current_run_state = nullptr;
+	// Reset dyn_var arena before starting new runs
+	get_invocation_state()->get_arena()->reset_arena();
+	run_state::current_run_state = nullptr;
 
+	update_max(e_state->max_visited_offsets, r_state->visited_offsets.size());
+	if (run_end.kind == run_exit::exit_kind::out_of_bools)
+		e_state->out_of_bools_count++;
+	else if (run_end.kind == run_exit::exit_kind::loop_back)
+		e_state->loop_back_count++;
+	else if (run_end.kind == run_exit::exit_kind::memoization)
+		e_state->memoization_count++;
+
+	if (run_end.kind == run_exit::exit_kind::out_of_bools) {
+		// The condition is turned into an if statement once both the 
+		// runs forked here are done
 		block::expr_stmt::Ptr last_stmt = block::to<block::expr_stmt>(r_state->current_stmt_block->stmts.back());
 		r_state->current_stmt_block->stmts.pop_back();
-
-		block::expr::Ptr cond_expr = last_stmt->expr1;
-	
-		// Establish two run_states
-		run_state true_r_state(r_state->e_state, r_state->i_state);
-		// Only copy over the expr_sequence since it is part of the r_state that 
-		// just terminated
-		true_r_state.cached_expr_sequence = r_state->cached_expr_sequence;
-		true_r_state.bool_vector.push_back(true);
-		true_r_state.visited_offsets = r_state->visited_offsets;
-		true_r_state.tag_deduplication_map = r_state->tag_deduplication_map;
-		std::copy(bool_vector_copy.begin(), bool_vector_copy.end(), std::back_inserter(true_r_state.bool_vector));
-
-		// Establish two run_states
-		run_state false_r_state(r_state->e_state, r_state->i_state);
-		false_r_state.visited_offsets = r_state->visited_offsets;
-		false_r_state.tag_deduplication_map = r_state->tag_deduplication_map;
-		// Only copy over the expr_sequence since it is part of the r_state that 
-		// just terminated
-		false_r_state.cached_expr_sequence = r_state->cached_expr_sequence;
-		false_r_state.bool_vector = true_r_state.bool_vector;
-		false_r_state.bool_vector[0] = false;
-
-		block::stmt_block::Ptr true_ast = block::to<block::stmt_block>(extract_ast_from_run(&true_r_state));
-		block::stmt_block::Ptr false_ast = block::to<block::stmt_block>(extract_ast_from_run(&false_r_state));
-
-		trim_ast_at_offset(true_ast, e.static_offset);
-		trim_ast_at_offset(false_ast, e.static_offset);
-
-		std::pair<std::vector<block::stmt::Ptr>, std::vector<block::stmt::Ptr>> trim_pair =
-		    trim_common_from_back(true_ast, false_ast);
-
-		std::vector<block::stmt::Ptr> trimmed_stmts = trim_pair.first;
-		std::vector<block::stmt::Ptr> split_decls = trim_pair.second;
-
-		r_state->erase_tag(e.static_offset);
-
-		block::if_stmt::Ptr new_if_stmt = std::make_shared<block::if_stmt>();
-		new_if_stmt->annotation = last_stmt->annotation;
-		new_if_stmt->static_offset = e.static_offset;
-
-		new_if_stmt->cond = cond_expr;
-		new_if_stmt->then_stmt = true_ast;
-		new_if_stmt->else_stmt = false_ast;
-
-		for (auto stmt : split_decls)
-			r_state->add_stmt_to_current_block(stmt, false);
-		r_state->add_stmt_to_current_block(new_if_stmt, false);
-
-		std::copy(trimmed_stmts.begin(), trimmed_stmts.end(), std::back_inserter(r_state->current_stmt_block->stmts));
-
-		ret_ast = ast;
-	} catch (LoopBackException &e) {
-		get_invocation_state()->get_arena()->reset_arena();
-		run_state::current_run_state = nullptr;
+		branch_offset = run_end.static_offset;
+		return last_stmt;
+	} else if (run_end.kind == run_exit::exit_kind::loop_back) {
 		block::goto_stmt::Ptr goto_stmt = std::make_shared<block::goto_stmt>();
 		goto_stmt->static_offset.clear();
-		goto_stmt->temporary_label_number = e.static_offset;
+		goto_stmt->temporary_label_number = run_end.static_offset;
 
 		r_state->add_stmt_to_current_block(goto_stmt, false);
-		ret_ast = ast;
-	} catch (MemoizationException &e) {
-		get_invocation_state()->get_arena()->reset_arena();
-		run_state::current_run_state = nullptr;
+	} else if (run_end.kind == run_exit::exit_kind::memoization) {
+		memo_lock = r_state->e_state->lock_memoization();
 		if (feature_unstructured) {
 			// Instead of copying statements to the current block, we will just insert a goto
 			block::goto_stmt::Ptr goto_stmt = std::make_shared<block::goto_stmt>();
 			goto_stmt->static_offset.clear();
-			goto_stmt->temporary_label_number = e.static_offset;
+			goto_stmt->temporary_label_number = run_end.static_offset;
 			r_state->add_stmt_to_current_block(goto_stmt, false);
 		} else {
-			for (unsigned int i = e.child_id; i < e.parent->stmts.size(); i++) {
-				if (block::isa<block::goto_stmt>(e.parent->stmts[i])) {
+			for (unsigned int i = run_end.child_id; i < run_end.parent->stmts.size(); i++) {
+				if (block::isa<block::goto_stmt>(run_end.parent->stmts[i])) {
 					block::goto_stmt::Ptr goto_stmt = std::make_shared<block::goto_stmt>();
 					goto_stmt->static_offset.clear();
-					goto_stmt->temporary_label_number = block::to<block::goto_stmt>(e.parent->stmts[i])->temporary_label_number;
+					goto_stmt->temporary_label_number = block::to<block::goto_stmt>(run_end.parent->stmts[i])->temporary_label_number;
 					r_state->add_stmt_to_current_block(goto_stmt, false);
 				}
 				else {
-					r_state->add_stmt_to_current_block(e.parent->stmts[i], false);
+					r_state->add_stmt_to_current_block(run_end.parent->stmts[i], false);
 				}
 			}
 		}
-		ret_ast = ast;
-	} 
+	}
 
+	return nullptr;
+}
 
-	run_state::current_run_state = nullptr;
+std::unique_ptr<run_state> builder_context::fork_run(run_state* r_state, const std::vector<bool>& bool_vector,
+						     bool branch_value, bool is_last_fork) {
+	std::unique_ptr<run_state> child(new run_state(r_state->e_state, r_state->i_state));
+	child->bool_vector.push_back(branch_value);
+	std::copy(bool_vector.begin(), bool_vector.end(), std::back_inserter(child->bool_vector));
+	// The visited offsets are still needed by the parent when the if statement 
+	// is inserted, but the expr_sequence is only needed for replaying
+	child->visited_offsets = r_state->visited_offsets;
+	child->tag_deduplication_map = r_state->tag_deduplication_map;
+	if (is_last_fork) {
+		child->cached_expr_sequence = std::move(r_state->cached_expr_sequence);
+		child->cached_var_tags = std::move(r_state->cached_var_tags);
+	} else {
+		child->cached_expr_sequence = r_state->cached_expr_sequence;
+		child->cached_var_tags = r_state->cached_var_tags;
+	}
+	return child;
+}
+
+void builder_context::merge_branches(run_state* r_state, block::expr_stmt::Ptr branch_stmt, tracer::tag branch_offset,
+				     block::stmt_block::Ptr true_ast, block::stmt_block::Ptr false_ast) {
+	trim_ast_at_offset(true_ast, branch_offset);
+	trim_ast_at_offset(false_ast, branch_offset);
+
+	std::pair<std::vector<block::stmt::Ptr>, std::vector<block::stmt::Ptr>> trim_pair =
+	    trim_common_from_back(true_ast, false_ast);
+
+	std::vector<block::stmt::Ptr> trimmed_stmts = trim_pair.first;
+	std::vector<block::stmt::Ptr> split_decls = trim_pair.second;
+
+	r_state->erase_tag(branch_offset);
+
+	block::if_stmt::Ptr new_if_stmt = std::make_shared<block::if_stmt>();
+	new_if_stmt->annotation = branch_stmt->annotation;
+	new_if_stmt->static_offset = branch_offset;
+
+	new_if_stmt->cond = branch_stmt->expr1;
+	new_if_stmt->then_stmt = true_ast;
+	new_if_stmt->else_stmt = false_ast;
+
+	for (auto stmt : split_decls)
+		r_state->add_stmt_to_current_block(stmt, false);
+	r_state->add_stmt_to_current_block(new_if_stmt, false);
+
+	std::copy(trimmed_stmts.begin(), trimmed_stmts.end(), std::back_inserter(r_state->current_stmt_block->stmts));
+}
+
+block::stmt_block::Ptr builder_context::update_memoization(run_state* r_state) {
+	execution_state* e_state = r_state->e_state;
+	// Searching the block finds the first statement with a tag, keep
+	// pointing to that one if the tag repeats
+	auto memoize = [&](const tracer::tag& t, block::stmt_block::Ptr parent, size_t index) {
+		tracer::tag_id id = e_state->get_tag_id(t);
+		auto it = e_state->memoized_tags.find(id);
+		if (it != e_state->memoized_tags.end() && it->second.parent == parent && it->second.index < index)
+			return;
+		e_state->set_memoized(id, parent, index);
+	};
 
 	// Update the memoized table with the stmt block we just created
 	for (unsigned int i = 0; i < r_state->current_stmt_block->stmts.size(); i++) {
@@ -394,31 +589,447 @@ block::stmt::Ptr builder_context::extract_ast_from_run(run_state* r_state) {
 			block::if_stmt::Ptr if1 = block::to<block::if_stmt>(s);
 			assert(block::isa<block::stmt_block>(if1->then_stmt));
 			assert(block::isa<block::stmt_block>(if1->else_stmt));
-			for (auto &stmt : block::to<block::stmt_block>(if1->then_stmt)->stmts) {
-				auto it = r_state->e_state->memoized_tags.find(stmt->static_offset);
-				if (it != r_state->e_state->memoized_tags.end())
-					r_state->e_state->memoized_tags.erase(it);
-
-				if (feature_unstructured) {
-					auto pblock = block::to<block::stmt_block>(if1->then_stmt);
-					r_state->e_state->memoized_tags[stmt->static_offset] = pblock;
-				}
+			auto then_block = block::to<block::stmt_block>(if1->then_stmt);
+			for (unsigned int j = 0; j < then_block->stmts.size(); j++) {
+				e_state->erase_memoized(e_state->get_tag_id(then_block->stmts[j]->static_offset));
+				if (feature_unstructured)
+					memoize(then_block->stmts[j]->static_offset, then_block, j);
 			}
-			for (auto &stmt : block::to<block::stmt_block>(if1->else_stmt)->stmts) {
-				auto it = r_state->e_state->memoized_tags.find(stmt->static_offset);
-				if (it != r_state->e_state->memoized_tags.end())
-					r_state->e_state->memoized_tags.erase(it);
-				if (feature_unstructured) {
-					auto pblock = block::to<block::stmt_block>(if1->else_stmt);
-					r_state->e_state->memoized_tags[stmt->static_offset] = pblock;
-				}
+			auto else_block = block::to<block::stmt_block>(if1->else_stmt);
+			for (unsigned int j = 0; j < else_block->stmts.size(); j++) {
+				e_state->erase_memoized(e_state->get_tag_id(else_block->stmts[j]->static_offset));
+				if (feature_unstructured)
+					memoize(else_block->stmts[j]->static_offset, else_block, j);
+			}
+		}
+		memoize(s->static_offset, r_state->current_stmt_block, i);
+	}
+
+	block::stmt_block::Ptr ret_ast = r_state->current_stmt_block;
+	r_state->current_stmt_block = nullptr;
+	return ret_ast;
+}
+
+block::stmt::Ptr builder_context::extract_ast_from_run(run_state* r_state) {
+	// Held from the point the blocks of this run and its children are 
+	// touched till they are updated in the memoization table
+	std::unique_lock<std::mutex> memo_lock;
+
+	std::vector<bool> bool_vector_copy = r_state->bool_vector;
+
+	tracer::tag branch_offset;
+	block::expr_stmt::Ptr branch_stmt = execute_run(r_state, branch_offset, memo_lock);
+
+	if (branch_stmt != nullptr) {
+		// Establish two run_states
+		std::unique_ptr<run_state> true_r_state = fork_run(r_state, bool_vector_copy, true, false);
+		std::unique_ptr<run_state> false_r_state = fork_run(r_state, bool_vector_copy, false, true);
+
+		block::stmt_block::Ptr true_ast;
+		block::stmt_block::Ptr false_ast;
+
+		utils::work_stealing_pool* pool = r_state->e_state->pool;
+		if (pool != nullptr) {
+			// Runs write to the cached expressions while they replay the prefix. 
+			// These expressions are also reachable from the blocks and visited 
+			// offsets of other runs, so give both runs their own copies
+			for (auto &cached_expr : true_r_state->cached_expr_sequence)
+				cached_expr = block::clone(cached_expr);
+			for (auto &cached_expr : false_r_state->cached_expr_sequence)
+				cached_expr = block::clone(cached_expr);
+
+			utils::pool_task false_task([&]() {
+				false_ast = block::to<block::stmt_block>(extract_ast_from_run(false_r_state.get()));
+			});
+			pool->spawn(&false_task);
+
+			// The spawned run refers to this frame, so it has to be joined 
+			// even if the inline run fails
+			std::exception_ptr true_error;
+			try {
+				true_ast = block::to<block::stmt_block>(extract_ast_from_run(true_r_state.get()));
+			} catch (...) {
+				true_error = std::current_exception();
 			}
+			pool->join(&false_task);
+			if (true_error)
+				std::rethrow_exception(true_error);
+		} else {
+			true_ast = block::to<block::stmt_block>(extract_ast_from_run(true_r_state.get()));
+			false_ast = block::to<block::stmt_block>(extract_ast_from_run(false_r_state.get()));
 		}
-		r_state->e_state->memoized_tags[s->static_offset] = r_state->current_stmt_block;
+
+		// The blocks of the two runs are now visible to the other runs 
+		// through the memoization table
+		memo_lock = r_state->e_state->lock_memoization();
+
+		merge_branches(r_state, branch_stmt, branch_offset, true_ast, false_ast);
 	}
 
-	ast = r_state->current_stmt_block = nullptr;
+	if (!memo_lock.owns_lock())
+		memo_lock = r_state->e_state->lock_memoization();
+	return update_memoization(r_state);
+}
+
+// A run on the worklist. The run_state of a forked run is only created when
+// the run is picked from the frontier, so the frontier just holds the parent
+namespace {
+struct run_frame {
+	std::shared_ptr<run_frame> parent;
+	// 0 for the run taking the true side of the parent's branch, 1 for the false side
+	int branch_index = 0;
+
+	std::unique_ptr<run_state> owned_r_state;
+	run_state* r_state = nullptr;
+	// Bool vector the run started with, the forked runs extend this
+	std::vector<bool> bool_vector;
+
+	// The branch this run ended on and the runs forked from it
+	block::expr_stmt::Ptr branch_stmt;
+	tracer::tag branch_offset;
+	int pending_forks = 0;
+	int pending_children = 0;
+	block::stmt_block::Ptr child_asts[2];
+};
+} // namespace
+
+block::stmt::Ptr builder_context::extract_ast_from_worklist(run_state* root_r_state) {
+	std::shared_ptr<run_frame> root = std::make_shared<run_frame>();
+	root->r_state = root_r_state;
+
+	std::deque<std::shared_ptr<run_frame>> frontier;
+	frontier.push_back(root);
+
+	block::stmt_block::Ptr ret_ast;
+	// Sequential extraction doesn't lock, this is only passed along
+	std::unique_lock<std::mutex> memo_lock;
+
+	while (!frontier.empty()) {
+		std::shared_ptr<run_frame> frame;
+		bool pick_back = (extraction_order == traversal_order::depth_first) ||
+				 (max_frontier_size != 0 && frontier.size() > max_frontier_size);
+		if (pick_back) {
+			frame = frontier.back();
+			frontier.pop_back();
+		} else {
+			frame = frontier.front();
+			frontier.pop_front();
+		}
+
+		if (frame->r_state == nullptr) {
+			run_frame* parent = frame->parent.get();
+			parent->pending_forks--;
+			frame->owned_r_state = fork_run(parent->r_state, parent->bool_vector, frame->branch_index == 0,
+							parent->pending_forks == 0);
+			frame->r_state = frame->owned_r_state.get();
+		}
+
+		frame->bool_vector = frame->r_state->bool_vector;
+		if (resume_branches) {
+			frame->r_state->resume_branches = true;
+			frame->r_state->resume_bool_vector = frame->r_state->bool_vector;
+		}
+		frame->branch_stmt = execute_run(frame->r_state, frame->branch_offset, memo_lock);
+
+		if (frame->branch_stmt != nullptr) {
+			frame->pending_forks = frame->pending_children = 2;
+			std::shared_ptr<run_frame> true_frame = std::make_shared<run_frame>();
+			true_frame->parent = frame;
+			true_frame->branch_index = 0;
+			std::shared_ptr<run_frame> false_frame = std::make_shared<run_frame>();
+			false_frame->parent = frame;
+			false_frame->branch_index = 1;
+			// The true side is picked first in both orders, which is 
+			// the order the recursive extraction uses
+			if (extraction_order == traversal_order::depth_first) {
+				frontier.push_back(false_frame);
+				frontier.push_back(true_frame);
+			} else {
+				frontier.push_back(true_frame);
+				frontier.push_back(false_frame);
+			}
+			continue;
+		}
+
+		// Split a run that continued past branches into a frame per branch, 
+		// as if it had ended at each of them and its true side was picked. 
+		// Only the false sides are left to run
+		if (!frame->r_state->resumed_branches.empty()) {
+			std::vector<run_state::resumed_branch> branches = std::move(frame->r_state->resumed_branches);
+			frame->r_state->resumed_branches.clear();
+			std::unique_ptr<run_state> live_r_state = std::move(frame->owned_r_state);
+			run_state* live = frame->r_state;
+
+			// The outermost branch takes over the frame the run started in
+			std::shared_ptr<run_frame> branch_frame = frame;
+			for (unsigned int i = 0; i < branches.size(); i++) {
+				run_state::resumed_branch &branch = branches[i];
+				if (i > 0) {
+					std::shared_ptr<run_frame> inner_frame = std::make_shared<run_frame>();
+					inner_frame->parent = branch_frame;
+					inner_frame->branch_index = 0;
+					branch_frame = inner_frame;
+				}
+				branch_frame->owned_r_state = std::move(branch.parent);
+				branch_frame->r_state = branch_frame->owned_r_state.get();
+				branch_frame->bool_vector = std::move(branch.bool_vector);
+				branch_frame->branch_stmt = branch.branch_stmt;
+				branch_frame->branch_offset = branch.branch_offset;
+				branch_frame->pending_forks = 1;
+				branch_frame->pending_children = 2;
+
+				std::shared_ptr<run_frame> false_frame = std::make_shared<run_frame>();
+				false_frame->parent = branch_frame;
+				false_frame->branch_index = 1;
+				frontier.push_back(false_frame);
+			}
+
+			std::shared_ptr<run_frame> live_frame = std::make_shared<run_frame>();
+			live_frame->parent = branch_frame;
+			live_frame->branch_index = 0;
+			live_frame->owned_r_state = std::move(live_r_state);
+			live_frame->r_state = live;
+			frame = live_frame;
+		}
+
+		// The run is complete, hand the block over to the parent and merge 
+		// every ancestor whose forked runs are now all complete
+		while (1) {
+			block::stmt_block::Ptr run_ast = update_memoization(frame->r_state);
+			std::shared_ptr<run_frame> parent = frame->parent;
+			if (parent == nullptr) {
+				ret_ast = run_ast;
+				break;
+			}
+			parent->child_asts[frame->branch_index] = run_ast;
+			frame = nullptr;
+			if (--parent->pending_children > 0)
+				break;
+			merge_branches(parent->r_state, parent->branch_stmt, parent->branch_offset, parent->child_asts[0],
+				       parent->child_asts[1]);
+			parent->child_asts[0] = parent->child_asts[1] = nullptr;
+			frame = parent;
+		}
+	}
 	return ret_ast;
 }
 
+// Status a forked process reports its result with
+enum fork_status : uint64_t { fork_failed = 0, fork_succeeded = 1 };
+
+static bool write_all(int fd, const std::string &buffer) {
+	size_t written = 0;
+	while (written < buffer.size()) {
+		ssize_t ret = write(fd, buffer.data() + written, buffer.size() - written);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		written += ret;
+	}
+	return true;
+}
+
+static bool read_all(int fd, std::string &buffer) {
+	char chunk[65536];
+	while (1) {
+		ssize_t ret = read(fd, chunk, sizeof(chunk));
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0)
+			return false;
+		if (ret == 0)
+			return true;
+		buffer.append(chunk, ret);
+	}
+}
+
+static void flush_output(void) {
+	std::cout.flush();
+	std::cerr.flush();
+	fflush(nullptr);
+}
+
+// Sets up a newly forked process to report to the pipe
+void builder_context::start_forked_process(run_state *r_state, int result_fd) {
+	// Only the changes made after the fork are reported
+	static std::vector<std::pair<tracer::tag_id, execution_state::memoized_stmt>> memoization_log;
+	static std::vector<tracer::tag> created_tags;
+	memoization_log.clear();
+	created_tags.clear();
+
+	if (r_state->fork_result_fd != -1)
+		close(r_state->fork_result_fd);
+	r_state->fork_branches = true;
+	r_state->fork_result_fd = result_fd;
+	// Blocks created from here on are new to the parent
+	block::block::current_fork_epoch++;
+	r_state->fork_nd_states = r_state->i_state->nd_state_map.size();
+	// The branches forked so far are merged by the processes that forked them
+	r_state->forked_branches.clear();
+	r_state->e_state->memoization_log = &memoization_log;
+	r_state->i_state->tag_factory_instance.created_tags = &created_tags;
+}
+
+block::stmt_block::Ptr builder_context::read_forked_result(run_state *r_state, int fd, pid_t pid) {
+	std::string buffer;
+	bool read_ok = read_all(fd, buffer);
+	close(fd);
+	int status;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+		;
+	if (!read_ok)
+		return nullptr;
+
+	// The dependencies on nd_var states of the statements aren't sent back
+	r_state->e_state->nd_dependencies_known = false;
+	block::block_reader reader(buffer);
+	reader.trie = &r_state->i_state->call_stack_trie_instance;
+	if (reader.read_u64() != fork_succeeded)
+		return nullptr;
+	block::stmt_block::Ptr ast = reader.read_block_as<block::stmt_block>();
+
+	// Make the same changes to the tag factory and the memoization table
+	// the forked process made. The tags are created in the same order, so 
+	// the memoized tag ids are the same here
+	uint64_t count = reader.read_u64();
+	for (uint64_t i = 0; i < count && !reader.failed; i++)
+		r_state->i_state->tag_factory_instance.create_tag_id(reader.read_tag());
+	count = reader.read_u64();
+	for (uint64_t i = 0; i < count && !reader.failed; i++) {
+		tracer::tag_id t = reader.read_u64();
+		block::stmt_block::Ptr b = reader.read_block_as<block::stmt_block>();
+		size_t index = reader.read_u64();
+		if (b != nullptr)
+			r_state->e_state->set_memoized(t, b, index);
+		else
+			r_state->e_state->erase_memoized(t);
+	}
+	uint64_t unique_tag_count = reader.read_u64();
+
+	if (reader.failed || !reader.at_end() || ast == nullptr)
+		return nullptr;
+	tracer::set_unique_tag_count(unique_tag_count);
+	return ast;
+}
+
+void builder_context::fail_forked_run(run_state *r_state) {
+	block::block_writer writer(0);
+	writer.write_u64(fork_failed);
+	write_all(r_state->fork_result_fd, writer.get_buffer());
+	flush_output();
+	_exit(1);
+}
+
+void builder_context::finish_forked_run(run_state *r_state) {
+	// Merge the branches this process forked at, innermost first, just like
+	// the runs forked at them would have been merged
+	block::stmt_block::Ptr ast = update_memoization(r_state);
+	while (!r_state->forked_branches.empty()) {
+		run_state::forked_branch &branch = r_state->forked_branches.back();
+		merge_branches(branch.parent.get(), branch.branch_stmt, branch.branch_offset, branch.true_ast, ast);
+		ast = update_memoization(branch.parent.get());
+		r_state->forked_branches.pop_back();
+	}
+
+	// nd_var states created here would be lost
+	if (r_state->i_state->nd_state_map.size() != r_state->fork_nd_states)
+		fail_forked_run(r_state);
+
+	block::block_writer writer(block::block::current_fork_epoch);
+	writer.write_u64(fork_succeeded);
+	writer.write_block(ast);
+	auto &created_tags = *r_state->i_state->tag_factory_instance.created_tags;
+	writer.write_u64(created_tags.size());
+	for (auto &t : created_tags)
+		writer.write_tag(t);
+	auto &memoization_log = *r_state->e_state->memoization_log;
+	writer.write_u64(memoization_log.size());
+	for (auto &entry : memoization_log) {
+		writer.write_u64(entry.first);
+		writer.write_block(entry.second.parent);
+		writer.write_u64(entry.second.index);
+	}
+	writer.write_u64(tracer::get_unique_tag_count());
+
+	if (writer.failed)
+		fail_forked_run(r_state);
+	if (!write_all(r_state->fork_result_fd, writer.get_buffer()))
+		_exit(1);
+	flush_output();
+	_exit(0);
+}
+
+bool builder_context::fork_at_branch(run_state *r_state, const tracer::tag &offset) {
+	int fds[2];
+	if (pipe(fds) != 0)
+		fail_forked_run(r_state);
+	flush_output();
+	pid_t pid = fork();
+	if (pid < 0)
+		fail_forked_run(r_state);
+
+	if (pid == 0) {
+		// The forked process extracts the true side. The statements till 
+		// the branch are kept by the parent
+		close(fds[0]);
+		start_forked_process(r_state, fds[1]);
+		r_state->current_stmt_block = std::make_shared<block::stmt_block>();
+		return true;
+	}
+
+	close(fds[1]);
+	block::stmt_block::Ptr true_ast = read_forked_result(r_state, fds[0], pid);
+	if (true_ast == nullptr)
+		fail_forked_run(r_state);
+
+	// Keep the state at the branch for merging, the same state a run 
+	// that ended here would have left
+	run_state::forked_branch branch;
+	branch.parent.reset(new run_state(r_state->e_state, r_state->i_state));
+	branch.parent->current_stmt_block = r_state->current_stmt_block;
+	branch.parent->visited_offsets = r_state->visited_offsets;
+	branch.parent->tag_deduplication_map = r_state->tag_deduplication_map;
+	branch.branch_stmt = block::to<block::expr_stmt>(r_state->current_stmt_block->stmts.back());
+	r_state->current_stmt_block->stmts.pop_back();
+	branch.branch_offset = offset;
+	branch.true_ast = true_ast;
+	r_state->forked_branches.push_back(std::move(branch));
+
+	// This run continues as the run that takes the false side
+	r_state->current_stmt_block = std::make_shared<block::stmt_block>();
+	return false;
+}
+
+block::stmt::Ptr builder_context::extract_ast_from_forks(run_state *r_state) {
+	int fds[2];
+	if (pipe(fds) != 0)
+		return nullptr;
+	flush_output();
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return nullptr;
+	}
+
+	if (pid == 0) {
+		// The whole extraction happens in forked processes, this process 
+		// only gets the result so it can fall back to replaying runs
+		close(fds[0]);
+		start_forked_process(r_state, fds[1]);
+		try {
+			tracer::tag branch_offset;
+			std::unique_lock<std::mutex> memo_lock;
+			execute_run(r_state, branch_offset, memo_lock);
+		} catch (...) {
+			fail_forked_run(r_state);
+		}
+		finish_forked_run(r_state);
+	}
+
+	close(fds[1]);
+	return read_forked_result(r_state, fds[0], pid);
+}
+
 } // namespace builder
@@ -2,8 +2,8 @@
 #include "builder/generics.h"
 namespace builder {
 
-std::vector<dyn_var_base *> *parents_stack = nullptr;
-bool user_defined_provider_track_members = false;
+thread_local std::vector<dyn_var_base *> *parents_stack = nullptr;
+thread_local bool user_defined_provider_track_members = false;
 
 int allocatable_type_registry::type_counter = 0;
 std::vector<allocatable_type_registry::deleter_t>* allocatable_type_registry::type_deleters = nullptr;
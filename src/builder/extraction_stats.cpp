@@ -0,0 +1,72 @@
+#include "builder/extraction_stats.h"
+
+namespace builder {
+
+static void dump_json_string(std::ostream &oss, const std::string &s) {
+	oss << "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\')
+			oss << "\\" << c;
+		else if ((unsigned char)c < 0x20)
+			oss << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xf];
+		else
+			oss << c;
+	}
+	oss << "\"";
+}
+
+void extraction_stats::dump_json(std::ostream &oss) const {
+	oss << "{\n";
+	oss << "  \"func_name\": ";
+	dump_json_string(oss, func_name);
+	oss << ",\n";
+	oss << "  \"runs\": " << runs << ",\n";
+	oss << "  \"out_of_bools\": " << out_of_bools << ",\n";
+	oss << "  \"loop_backs\": " << loop_backs << ",\n";
+	oss << "  \"memoization_hits\": " << memoization_hits << ",\n";
+	oss << "  \"nd_failures\": " << nd_failures << ",\n";
+	oss << "  \"stmts\": " << stmts << ",\n";
+	oss << "  \"max_bool_vector_depth\": " << max_bool_vector_depth << ",\n";
+	oss << "  \"tags_created\": " << tags_created << ",\n";
+	oss << "  \"memoized_tags\": " << memoized_tags << ",\n";
+	oss << "  \"nd_states\": " << nd_states << ",\n";
+	oss << "  \"max_visited_offsets\": " << max_visited_offsets << ",\n";
+	oss << "  \"extraction_ms\": " << extraction_ms << ",\n";
+	oss << "  \"pass_ms\": {";
+	for (unsigned int i = 0; i < pass_ms.size(); i++) {
+		oss << (i == 0 ? "\n    " : ",\n    ");
+		dump_json_string(oss, pass_ms[i].first);
+		oss << ": " << pass_ms[i].second;
+	}
+	oss << (pass_ms.empty() ? "}" : "\n  }");
+	if (!hash_tables.empty()) {
+		oss << ",\n  \"hash_tables\": [";
+		for (unsigned int i = 0; i < hash_tables.size(); i++) {
+			const hash_table_stats &s = hash_tables[i];
+			oss << (i == 0 ? "\n    {" : ",\n    {");
+			oss << "\"name\": ";
+			dump_json_string(oss, s.name);
+			oss << ", \"size\": " << s.size << ", \"buckets\": " << s.buckets;
+			oss << ", \"max_bucket_size\": " << s.max_bucket_size;
+			oss << ", \"colliding_keys\": " << s.colliding_keys;
+			oss << ", \"max_collision_chain\": " << s.max_collision_chain << "}";
+		}
+		oss << "\n  ]";
+	}
+	oss << "\n}\n";
+}
+
+double pass_timer::lap(void) {
+	auto now = std::chrono::steady_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(now - last).count();
+	last = now;
+	return ms;
+}
+
+void pass_timer::end_pass(const std::string &name) {
+	double ms = lap();
+	if (stats != nullptr)
+		stats->pass_ms.push_back({name, ms});
+}
+
+} // namespace builder
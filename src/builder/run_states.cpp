@@ -1,9 +1,11 @@
 #include "builder/run_states.h"
+#include "builder/builder_context.h"
 #include "builder/exceptions.h"
+#include "util/run_boundary.h"
 #include <algorithm>
 namespace builder {
 
-run_state* run_state::current_run_state = nullptr;
+thread_local run_state* run_state::current_run_state = nullptr;
 
 
 
@@ -15,79 +17,147 @@ void run_state::add_stmt_to_current_block(block::stmt::Ptr s, bool check_for_con
 	if (!current_annotations.empty()) {
 		s->annotation = get_and_clear_annotations();
 	}
-	if (!s->static_offset.is_empty() && is_visited_tag(s->static_offset) > 0) {
+	tracer::tag_id stag = e_state->get_tag_id(s->static_offset);
+	if (!s->static_offset.is_empty() && visited_offsets.contains(stag)) {
 		// Let's go and find that statement
-		auto lt = visited_offsets[s->static_offset];
+		auto lt = *visited_offsets.find(stag);
 		// This is only a loopback if it is an exact match
 		if (lt->is_same(s)) 
-			throw LoopBackException(s->static_offset);
+			end_run(run_exit::exit_kind::loop_back, s->static_offset);
 
 		// We have found a tag is the same, but statemetns aren't the same
 		// The tag we have has dedup_id as 0	
 		tracer::tag tag0 = s->static_offset;
+		tracer::tag_id tag0_id = stag;
 
-		if (tag_deduplication_map.find(tag0) == tag_deduplication_map.end()) {
+		if (!tag_deduplication_map.contains(tag0_id)) {
 			// If duplicates aren't seen before, insert this tag in the deduplication_map
 			// 1 is HOW many such tags exist, default is 1 for all tags
-			tag_deduplication_map[tag0] = 1;
+			tag_deduplication_map.set(tag0_id, 1);
 		}
 		// We have already checked 0
-		size_t d_id = 1, max_d_id = tag_deduplication_map[tag0];
+		size_t d_id = 1, max_d_id = *tag_deduplication_map.find(tag0_id);
 		for (d_id = 1; d_id < max_d_id; d_id++) {
 			tag0.dedup_id = d_id;
-			// Find the statement
-			auto lt = visited_offsets[tag0];
-			if (lt->is_same(s)) {
+			tag0.cached_hash = 0;
+			// Find the statement, the copy could have been erased at a merge
+			auto lt = visited_offsets.find(e_state->get_tag_id(tag0));
+			if (lt != nullptr && (*lt)->is_same(s)) {
 				s->static_offset = tag0;
 				s->static_offset.cached_string = "";
-				throw LoopBackException(s->static_offset);
+				end_run(run_exit::exit_kind::loop_back, s->static_offset);
 			}
 		}
 		// If we reached here, there is no match, this must be a new copy, update the tag and dedup map
 		s->static_offset.dedup_id = d_id;
 		s->static_offset.cached_string = "";
-		tag0.dedup_id = 0;
-		tag_deduplication_map[tag0] = d_id + 1;	
+		s->static_offset.cached_hash = 0;
+		stag = e_state->get_tag_id(s->static_offset);
+		tag_deduplication_map.set(tag0_id, d_id + 1);	
 	}
 
-	tracer::tag stag = s->static_offset;
+	// Other runs could be updating the memoized blocks concurrently
+	std::unique_lock<std::mutex> memo_lock;
+	if (check_for_conflicts)
+		memo_lock = e_state->lock_memoization();
 
-	if (e_state->memoized_tags.find(stag) != e_state->memoized_tags.end() && check_for_conflicts && 
-		bool_vector.size() == 0) {
+	auto memoized = e_state->memoized_tags.end();
+	if (check_for_conflicts && bool_vector.size() == 0)
+		memoized = e_state->memoized_tags.find(stag);
+	if (memoized != e_state->memoized_tags.end()) {
 		// This tag has been seen on some other execution. We can reuse.
 		// First find the tag -
-		block::stmt_block::Ptr parent = e_state->memoized_tags[stag];
-		unsigned int i = 0;
-		for (i = 0; i < parent->stmts.size(); i++) {
-			if (parent->stmts[i]->static_offset == s->static_offset)
-				break;
+		block::stmt_block::Ptr parent = memoized->second.parent;
+		unsigned int i = memoized->second.index;
+		// Statements can be trimmed from the back of the block after it 
+		// was memoized, search the block if the position is stale
+		if (i >= parent->stmts.size() || parent->stmts[i]->static_offset != s->static_offset) {
+			for (i = 0; i < parent->stmts.size(); i++) {
+				if (parent->stmts[i]->static_offset == s->static_offset)
+					break;
+			}
 		}
-		// Special case of stmt expr and if_stmt
-		if (block::isa<block::expr_stmt>(s) && block::isa<block::if_stmt>(parent->stmts[i])) {
-			block::if_stmt::Ptr p_stmt = block::to<block::if_stmt>(parent->stmts[i]);
-			block::expr_stmt::Ptr expr = block::to<block::expr_stmt>(s);
+		// With concurrent runs the block could have been trimmed since it was memoized
+		bool is_hit = false;
+		if (i < parent->stmts.size()) {
+			// Special case of stmt expr and if_stmt
+			if (block::isa<block::expr_stmt>(s) && block::isa<block::if_stmt>(parent->stmts[i])) {
+				block::if_stmt::Ptr p_stmt = block::to<block::if_stmt>(parent->stmts[i]);
+				block::expr_stmt::Ptr expr = block::to<block::expr_stmt>(s);
 
-			if (p_stmt->cond->is_same(expr->expr1))
-				throw MemoizationException(s->static_offset, parent, i);
+				if (p_stmt->cond->is_same(expr->expr1))
+					is_hit = true;
+			}
+			if (!is_hit && parent->stmts[i]->is_same(s))
+				is_hit = true;
 		}
 
-
-		if (parent->stmts[i]->is_same(s))
-			throw MemoizationException(s->static_offset, parent, i);
+		if (is_hit) {
+			if (e_state->pool != nullptr) {
+				// Other runs can trim the block once the lock is released, 
+				// hand out a copy of the statements to be reused instead
+				block::stmt_block::Ptr reused = std::make_shared<block::stmt_block>();
+				reused->stmts.assign(parent->stmts.begin() + i, parent->stmts.end());
+				end_run(run_exit::exit_kind::memoization, s->static_offset, reused, 0);
+			}
+			end_run(run_exit::exit_kind::memoization, s->static_offset, parent, i);
+		}
 	}
 	// If dedup happens, this has already been updated
-	visited_offsets[s->static_offset] = s;
+	visited_offsets.set(stag, s);
 	current_stmt_block->stmts.push_back(s);
+	e_state->stmt_count++;
+	if (!used_nd_states.empty())
+		e_state->add_nd_dependencies(s.get(), used_nd_states);
+}
+
+void run_state::end_run(run_exit::exit_kind kind, const tracer::tag &offset, block::stmt_block::Ptr parent,
+			int32_t child_id) {
+	if (exit_boundary == nullptr) {
+		switch (kind) {
+		case run_exit::exit_kind::out_of_bools:
+			throw OutOfBoolsException(offset);
+		case run_exit::exit_kind::loop_back:
+			throw LoopBackException(offset);
+		default:
+			throw MemoizationException(offset, parent, child_id);
+		}
+	}
+	pending_exit.kind = kind;
+	pending_exit.static_offset = offset;
+	pending_exit.parent = parent;
+	pending_exit.child_id = child_id;
+	utils::exit_to_boundary(exit_boundary);
+}
+
+void run_state::resume_at_branch(const tracer::tag &offset) {
+	// The parent takes over the statements till the branch, the same state 
+	// a run that ended here would have left
+	resumed_branch branch;
+	branch.parent.reset(new run_state(e_state, i_state));
+	branch.parent->current_stmt_block = current_stmt_block;
+	branch.parent->visited_offsets = visited_offsets;
+	branch.parent->tag_deduplication_map = tag_deduplication_map;
+	branch.parent->cached_expr_sequence = cached_expr_sequence;
+	branch.parent->cached_var_tags = cached_var_tags;
+
+	branch.branch_stmt = block::to<block::expr_stmt>(current_stmt_block->stmts.back());
+	current_stmt_block->stmts.pop_back();
+	branch.branch_offset = offset;
+	branch.bool_vector = resume_bool_vector;
+	resumed_branches.push_back(std::move(branch));
+
+	// This run now continues as the run that takes the true side
+	resume_bool_vector.insert(resume_bool_vector.begin(), true);
+	current_stmt_block = std::make_shared<block::stmt_block>();
 }
 
 bool run_state::is_visited_tag(tracer::tag &new_tag) {
-	if (visited_offsets.find(new_tag) != visited_offsets.end())
-		return true;
-	return false;
+	return visited_offsets.contains(e_state->get_tag_id(new_tag));
 }
 
 void run_state::erase_tag(tracer::tag &erase_tag) {
-	visited_offsets.erase(erase_tag);
+	visited_offsets.erase(e_state->get_tag_id(erase_tag));
 }
 void run_state::commit_uncommitted(void) {
 	for (auto block_ptr : uncommitted_sequence) {
@@ -141,7 +211,17 @@ bool run_state::get_next_bool(block::expr::Ptr expr) {
 	commit_uncommitted();
 	if (bool_vector.size() == 0) {
 		tracer::tag offset = expr->static_offset;
-		throw OutOfBoolsException(offset);
+		if (i_state->b_ctx->has_budgets()) {
+			auto lock = e_state->lock_shared_state();
+			e_state->branch_counts[offset.slice_loc()]++;
+		}
+		if (fork_branches)
+			return i_state->b_ctx->fork_at_branch(this, offset);
+		if (resume_branches) {
+			resume_at_branch(offset);
+			return true;
+		}
+		end_run(run_exit::exit_kind::out_of_bools, offset);
 	}
 	bool ret_val = bool_vector.back();
 	bool_vector.pop_back();
@@ -149,24 +229,86 @@ bool run_state::get_next_bool(block::expr::Ptr expr) {
 }
 
 void run_state::insert_live_dyn_var(const tracer::tag& t) {
-	// First convert the tag to tag_id using the invocation's tag factory
+	// Convert the tag to tag_id using the invocation's tag factory and 
+	// move to the live set with it
+	auto lock = e_state->lock_shared_state();
 	tracer::tag_id tid = i_state->tag_factory_instance.create_tag_id(t);
-	// Insert it into the live set and sort
-	live_dyn_vars.push_back(tid);
-	std::sort(live_dyn_vars.begin(), live_dyn_vars.end());
+	live_dyn_vars = i_state->live_var_table_instance.insert(live_dyn_vars, tid);
 }
 void run_state::remove_live_dyn_var(const tracer::tag& t) {
-	// First convert the tag to tag_id using the invocation's tag factory
+	auto lock = e_state->lock_shared_state();
 	tracer::tag_id tid = i_state->tag_factory_instance.create_tag_id(t);
+	live_dyn_vars = i_state->live_var_table_instance.remove(live_dyn_vars, tid);
+}
+
+tracer::tag_id execution_state::get_tag_id(const tracer::tag& t) {
+	auto lock = lock_shared_state();
+	return i_state->tag_factory_instance.create_tag_id(t);
+}
 
-	// Search using binary search, might not be exact
-	auto it = std::lower_bound(live_dyn_vars.begin(), live_dyn_vars.end(), tid);
+void execution_state::add_nd_dependencies(const block::stmt *s, const std::vector<nd_var_base *> &states) {
+	auto lock = lock_shared_state();
+	std::vector<nd_var_base *> &deps = nd_dependencies[s];
+	for (auto state : states)
+		if (std::find(deps.begin(), deps.end(), state) == deps.end())
+			deps.push_back(state);
+}
+
+// Returns the index of the last statement in the block that depends on the 
+// updated states, -1 if there is none. Blocks are only nested in if 
+// statements during the extraction
+static int find_last_dependent(block::stmt_block *b,
+			       const std::unordered_map<const block::stmt *, std::vector<nd_var_base *>> &deps,
+			       const std::vector<nd_var_base *> &updated_states,
+			       std::unordered_map<block::stmt_block *, int> &cache) {
+	auto cached = cache.find(b);
+	if (cached != cache.end())
+		return cached->second;
+	int last = -1;
+	for (int i = (int)b->stmts.size() - 1; i >= 0 && last == -1; i--) {
+		block::stmt::Ptr s = b->stmts[i];
+		auto it = deps.find(s.get());
+		if (it != deps.end()) {
+			for (auto state : it->second)
+				if (std::find(updated_states.begin(), updated_states.end(), state) != updated_states.end())
+					last = i;
+		}
+		if (last == -1 && block::isa<block::if_stmt>(s)) {
+			block::if_stmt::Ptr if_s = block::to<block::if_stmt>(s);
+			for (auto branch : {if_s->then_stmt, if_s->else_stmt}) {
+				if (block::isa<block::stmt_block>(branch) &&
+				    find_last_dependent(block::to<block::stmt_block>(branch).get(), deps, updated_states,
+							cache) != -1)
+					last = i;
+			}
+		}
+	}
+	cache[b] = last;
+	return last;
+}
 
-	// Check if we actually found the value
-	if (it != live_dyn_vars.end() && *it == tid) {
-		// Erase it. This shifts all subsequent elements left.
-		live_dyn_vars.erase(it); 
-	}	
+size_t execution_state::reuse_memoization(execution_state &failed, const std::vector<nd_var_base *> &updated_states) {
+	if (!failed.nd_dependencies_known)
+		return 0;
+	std::unordered_map<block::stmt_block *, int> cache;
+	for (auto &entry : failed.memoized_tags) {
+		block::stmt_block::Ptr parent = entry.second.parent;
+		size_t i = entry.second.index;
+		if (i >= parent->stmts.size() || get_tag_id(parent->stmts[i]->static_offset) != entry.first) {
+			for (i = 0; i < parent->stmts.size(); i++) {
+				if (get_tag_id(parent->stmts[i]->static_offset) == entry.first)
+					break;
+			}
+			if (i == parent->stmts.size())
+				continue;
+		}
+		// A hit reuses all the statements from the memoized one to the end of the block
+		if (find_last_dependent(parent.get(), failed.nd_dependencies, updated_states, cache) < (int)i)
+			memoized_tags[entry.first] = {parent, i};
+	}
+	// The kept statements could still depend on the other states
+	nd_dependencies = std::move(failed.nd_dependencies);
+	return memoized_tags.size();
 }
 
 }
@@ -0,0 +1,7 @@
+#include "util/persistent_map.h"
+
+namespace utils {
+std::atomic<int64_t> persistent_map_counters::live_nodes(0);
+std::atomic<int64_t> persistent_map_counters::peak_nodes(0);
+std::atomic<int64_t> persistent_map_counters::copied_nodes(0);
+} // namespace utils
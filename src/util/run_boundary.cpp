@@ -0,0 +1,46 @@
+#include "util/run_boundary.h"
+#include <cstdint>
+#include <cstdlib>
+#include <unwind.h>
+
+namespace utils {
+
+// The unwind needs an exception object that outlives the frames being
+// unwound. Only one exit can be in flight per thread
+static thread_local _Unwind_Exception exit_exception;
+
+// "BLDTEXIT", the exception class of the forced unwinds
+static const uint64_t exit_exception_class = 0x424c445445584954ULL;
+
+static void exit_exception_cleanup(_Unwind_Reason_Code, _Unwind_Exception *) {
+	// The exception object is never allocated, nothing to free
+}
+
+static _Unwind_Reason_Code exit_stop(int version, _Unwind_Action actions, _Unwind_Exception_Class exc_class,
+				     _Unwind_Exception *exc, _Unwind_Context *context, void *param) {
+	run_boundary *b = (run_boundary *)param;
+	// The frames below the boundary have their CFA below the frame address of the
+	// boundary. The first frame above it is the boundary itself, all the frames
+	// that needed cleaning up are done by now
+	if ((actions & _UA_END_OF_STACK) || (uintptr_t)_Unwind_GetCFA(context) > (uintptr_t)b->frame)
+		std::longjmp(b->env, 1);
+	return _URC_NO_REASON;
+}
+
+bool run_under_boundary(run_boundary *b, const std::function<void(void)> &f) {
+	b->frame = __builtin_frame_address(0);
+	if (setjmp(b->env) != 0)
+		return true;
+	f();
+	return false;
+}
+
+void exit_to_boundary(run_boundary *b) {
+	exit_exception.exception_class = exit_exception_class;
+	exit_exception.exception_cleanup = exit_exception_cleanup;
+	_Unwind_ForcedUnwind(&exit_exception, exit_stop, b);
+	// Forced unwinds only return if the stack couldn't be walked
+	std::abort();
+}
+
+} // namespace utils
@@ -1,6 +1,8 @@
 #include "util/tracer.h"
 #include "builder/builder_context.h"
 #include "builder/static_var.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
 
 #ifdef TRACER_USE_LIBUNWIND
@@ -15,75 +17,184 @@ extern void lambda_wrapper_close(void);
 
 
 namespace tracer {
-#ifdef TRACER_USE_LIBUNWIND
+call_stack::call_stack(std::shared_ptr<const call_stack> parent, unsigned long long address)
+    : parent(parent), address(address) {
+	depth = parent == nullptr ? 1 : parent->depth + 1;
+	hash = hash_combine(parent == nullptr ? 0 : parent->hash, std::hash<unsigned long long>{}(address));
+}
+
+std::vector<unsigned long long> call_stack::get_pointers(void) const {
+	std::vector<unsigned long long> pointers;
+	pointers.reserve(depth);
+	for (const call_stack *s = this; s != nullptr; s = s->parent.get())
+		pointers.push_back(s->address);
+	return pointers;
+}
+
+std::shared_ptr<const call_stack> call_stack_trie::intern(const unsigned long long *pointers, size_t size) {
+	// The trie starts from the outermost frame
+	size_t depth = 0;
+	while (depth < size && depth < last_stack.size() && last_stack[depth]->address == pointers[size - 1 - depth])
+		depth++;
+	last_stack.resize(depth);
+	for (; depth < size; depth++) {
+		std::shared_ptr<const call_stack> parent = depth == 0 ? nullptr : last_stack[depth - 1];
+		std::shared_ptr<const call_stack> &child = children[{parent.get(), pointers[size - 1 - depth]}];
+		if (child == nullptr)
+			child = std::make_shared<call_stack>(parent, pointers[size - 1 - depth]);
+		last_stack.push_back(child);
+	}
+	if (size == 0)
+		return nullptr;
+	return last_stack.back();
+}
+
+std::shared_ptr<const call_stack> make_call_stack(const std::vector<unsigned long long> &pointers) {
+	std::shared_ptr<const call_stack> stack;
+	for (size_t i = pointers.size(); i > 0; i--)
+		stack = std::make_shared<call_stack>(stack, pointers[i - 1]);
+	return stack;
+}
+
+size_t live_var_set::id_hash(tag_id id) {
+	// Ids are small consecutive numbers, mix them before they are summed
+	return hash_mix(id);
+}
+
+std::shared_ptr<const live_var_set> live_var_table::intern(live_var_set &&set) {
+	auto &bucket = sets[set.hash];
+	for (auto &s : bucket)
+		if (s->ids == set.ids)
+			return s;
+	bucket.push_back(std::make_shared<live_var_set>(std::move(set)));
+	return bucket.back();
+}
+
+std::shared_ptr<const live_var_set> live_var_table::insert(const std::shared_ptr<const live_var_set> &from, tag_id id) {
+	std::shared_ptr<const live_var_set> &to = transitions[{from.get(), id, true}];
+	if (to != nullptr)
+		return to;
+	live_var_set set;
+	if (from != nullptr)
+		set = *from;
+	set.ids.insert(std::upper_bound(set.ids.begin(), set.ids.end(), id), id);
+	set.hash += live_var_set::id_hash(id);
+	to = intern(std::move(set));
+	return to;
+}
+
+std::shared_ptr<const live_var_set> live_var_table::remove(const std::shared_ptr<const live_var_set> &from, tag_id id) {
+	if (from == nullptr)
+		return nullptr;
+	std::shared_ptr<const live_var_set> &to = transitions[{from.get(), id, false}];
+	if (to != nullptr)
+		return to;
+	auto it = std::lower_bound(from->ids.begin(), from->ids.end(), id);
+	if (it == from->ids.end() || *it != id) {
+		to = from;
+		return to;
+	}
+	if (from->ids.size() == 1)
+		return nullptr;
+	live_var_set set = *from;
+	set.ids.erase(set.ids.begin() + (it - from->ids.begin()));
+	set.hash -= live_var_set::id_hash(id);
+	to = intern(std::move(set));
+	return to;
+}
+
+std::shared_ptr<const live_var_set> make_live_var_set(const std::vector<tag_id> &ids) {
+	if (ids.empty())
+		return nullptr;
+	auto set = std::make_shared<live_var_set>();
+	set->ids = ids;
+	for (auto id : ids)
+		set->hash += live_var_set::id_hash(id);
+	return set;
+}
+
+// The stack is walked here and not in a helper, so that the first return 
+// address captured is always in this function
 tag get_offset_in_function(void) {
 	unsigned long long function = (unsigned long long)(void *)builder::lambda_wrapper;
 	unsigned long long function_end = (unsigned long long)(void *)builder::lambda_wrapper_close;
-	unw_context_t context;
-	unw_cursor_t cursor;
-
-	unw_getcontext(&context);
-	unw_init_local(&cursor, &context);
 
 	tag new_tag;
 	new_tag.dedup_id = 0;
 
-	while (unw_step(&cursor)) {
-		unw_word_t ip;
-		unw_get_reg(&cursor, UNW_REG_IP, &ip);
-		if ((unsigned long long)ip >= function && (unsigned long long)ip < function_end)
+	builder::run_state *r_state = builder::get_run_state();
+
+	// Return addresses innermost frame first, interned into the trie below
+	static thread_local std::vector<unsigned long long> pointers;
+	pointers.clear();
+
+#if defined(TRACER_USE_LIBUNWIND)
+	// Cache the unwind info of the frames per thread instead of looking it 
+	// up again for every tag. unw_backtrace also keeps a per thread cache 
+	// from return addresses to frame layouts, instead of stepping a cursor
+	static bool cache_enabled = (unw_set_caching_policy(unw_local_addr_space, UNW_CACHE_PER_THREAD), true);
+	(void)cache_enabled;
+	void *buffer[50];
+
+	int backtrace_size = unw_backtrace(buffer, 50);
+	for (int i = 0; i < backtrace_size; i++) {
+		if ((unsigned long long)buffer[i] >= function && (unsigned long long)buffer[i] < function_end)
 			break;
-		new_tag.pointers.push_back((unsigned long long)ip);
+		pointers.push_back((unsigned long long)buffer[i]);
 	}
-
-	// Now add snapshots of static vars
-	for (auto tuple : builder::get_run_state()->deferred_static_var_tuples) {
-		if (tuple == nullptr) {
-			new_tag.static_var_snapshots.push_back(nullptr);
-			continue;
-		}
-		new_tag.static_var_snapshots.push_back(tuple->snapshot());
-		if (builder::get_builder_context()->enable_d2x) {
-			new_tag.static_var_key_values.push_back({tuple->var_name, tuple->serialize()});
+#elif defined(TRACER_USE_FRAME_POINTERS)
+	// Every frame starts with the frame pointer of its caller followed by 
+	// the return address. This needs all the frames till lambda_wrapper to 
+	// keep the frame pointer, which the build option makes sure of
+	void **frame = (void **)__builtin_frame_address(0);
+	bool reached_wrapper = false;
+	int walked = 0;
+	for (; walked < 50 && frame != nullptr; walked++) {
+		unsigned long long ip = (unsigned long long)frame[1];
+		if (ip >= function && ip < function_end) {
+			reached_wrapper = true;
+			break;
 		}
+		pointers.push_back(ip);
+		void **next = (void **)frame[0];
+		// The stack grows down and ends at the frame that started the run, 
+		// anything else isn't the caller's frame
+		if (next <= frame || (void *)next >= r_state->stack_top)
+			break;
+		frame = next;
 	}
-	for (auto tuple : builder::get_run_state()->static_var_tuples) {
-		if (tuple == nullptr) {
-			new_tag.static_var_snapshots.push_back(nullptr);
-			continue;
-		}
-		new_tag.static_var_snapshots.push_back(tuple->snapshot());
-		if (builder::get_builder_context()->enable_d2x) {
-			new_tag.static_var_key_values.push_back({tuple->var_name, tuple->serialize()});
+	// The chain ended before lambda_wrapper, a frame on the way was 
+	// compiled without its frame pointer. Walk this stack with backtrace 
+	// instead of dropping the frames above it
+	if (!reached_wrapper && walked < 50) {
+		pointers.clear();
+		void *buffer[50];
+		int backtrace_size = backtrace(buffer, 50);
+		for (int i = 0; i < backtrace_size; i++) {
+			if ((unsigned long long)buffer[i] >= function && (unsigned long long)buffer[i] < function_end)
+				break;
+			pointers.push_back((unsigned long long)buffer[i]);
 		}
 	}
-
-	// Finally add the live_dyn_var set
-	new_tag.live_dyn_vars = builder::get_run_state()->live_dyn_vars;
-
-	return new_tag;
-}
-
 #else
-tag get_offset_in_function(void) {
-	unsigned long long function = (unsigned long long)(void *)builder::lambda_wrapper;
-	unsigned long long function_end = (unsigned long long)(void *)builder::lambda_wrapper_close;
-
 	void *buffer[50];
-	tag new_tag;
-	new_tag.dedup_id = 0;
 
 	// First add the RIP pointers
 	int backtrace_size = backtrace(buffer, 50);
 	for (int i = 0; i < backtrace_size; i++) {
 		if ((unsigned long long)buffer[i] >= function && (unsigned long long)buffer[i] < function_end)
 			break;
-		new_tag.pointers.push_back((unsigned long long)buffer[i]);
+		pointers.push_back((unsigned long long)buffer[i]);
 	}
+#endif
 
-	// Now add snapshots of static vars
+	{
+		auto lock = r_state->e_state->lock_shared_state();
+		new_tag.stack = r_state->i_state->call_stack_trie_instance.intern(pointers.data(), pointers.size());
+	}
 
-	for (auto tuple : builder::get_run_state()->deferred_static_var_tuples) {
+	// Now add snapshots of static vars
+	for (auto tuple : r_state->deferred_static_var_tuples) {
 		if (tuple == nullptr) {
 			new_tag.static_var_snapshots.push_back(nullptr);
 			continue;
@@ -93,7 +204,7 @@ tag get_offset_in_function(void) {
 			new_tag.static_var_key_values.push_back({tuple->var_name, tuple->serialize()});
 		}
 	}
-	for (auto tuple : builder::get_run_state()->static_var_tuples) {
+	for (auto tuple : r_state->static_var_tuples) {
 		if (tuple == nullptr) {
 			new_tag.static_var_snapshots.push_back(nullptr);
 			continue;
@@ -105,19 +216,33 @@ tag get_offset_in_function(void) {
 	}
 
 	// Finally add the live_dyn_var set
-	new_tag.live_dyn_vars = builder::get_run_state()->live_dyn_vars;
+	new_tag.live_dyn_vars = r_state->live_dyn_vars;
 
 	return new_tag;
 }
+
+const char *get_stack_walker_name(void) {
+#if defined(TRACER_USE_LIBUNWIND)
+	return "libunwind";
+#elif defined(TRACER_USE_FRAME_POINTERS)
+	return "frame pointers";
+#else
+	return "backtrace";
 #endif
-static unsigned long long unique_tag_counter = 0;
+}
+
+static std::atomic<unsigned long long> unique_tag_counter(0);
 tag get_unique_tag(void) {
 	tag new_tag;
-	new_tag.pointers.push_back(0);
-	new_tag.pointers.push_back(unique_tag_counter);
-	unique_tag_counter++;
+	new_tag.stack = make_call_stack({0, unique_tag_counter++});
 	return new_tag;
 }
+unsigned long long get_unique_tag_count(void) {
+	return unique_tag_counter;
+}
+void set_unique_tag_count(unsigned long long count) {
+	unique_tag_counter = count;
+}
 
 
 
@@ -127,11 +252,17 @@ bool tag::operator==(const tag &other) const {
 	if (dedup_id != other.dedup_id)
 		return false;
 
-	if (other.pointers.size() != pointers.size())
-		return false;
-	for (unsigned int i = 0; i < pointers.size(); i++)
-		if (pointers[i] != other.pointers[i])
+	// Stacks interned in the same trie are equal only if they are the same 
+	// node, the others are compared frame by frame
+	if (stack != other.stack) {
+		if (stack == nullptr || other.stack == nullptr)
+			return false;
+		if (stack->hash != other.stack->hash || stack->depth != other.stack->depth)
 			return false;
+		for (const call_stack *a = stack.get(), *b = other.stack.get(); a != b; a = a->parent.get(), b = b->parent.get())
+			if (a->address != b->address)
+				return false;
+	}
 	if (other.static_var_snapshots.size() != static_var_snapshots.size())
 		return false;
 
@@ -149,12 +280,14 @@ bool tag::operator==(const tag &other) const {
 		
 	}
 
-	// Finally compare the live_dyn_vars
-	if (live_dyn_vars.size() != other.live_dyn_vars.size())
-		return false;
-	for (unsigned int i = 0; i < live_dyn_vars.size(); i++) 
-		if (!(live_dyn_vars[i] == other.live_dyn_vars[i])) 
+	// Finally compare the live_dyn_vars, sets from the same table are 
+	// only equal if they are the same object
+	if (live_dyn_vars != other.live_dyn_vars) {
+		if (live_dyn_vars == nullptr || other.live_dyn_vars == nullptr)
 			return false;
+		if (live_dyn_vars->hash != other.live_dyn_vars->hash || live_dyn_vars->ids != other.live_dyn_vars->ids)
+			return false;
+	}
 	
 	return true;
 }
@@ -163,6 +296,7 @@ std::string tag::stringify(void) {
 	if (cached_string != "")
 		return cached_string;
 
+	std::vector<unsigned long long> pointers = get_pointers();
 	std::string output_string = "[";
 	for (unsigned int i = 0; i < pointers.size(); i++) {
 		char temp[128];
@@ -183,10 +317,12 @@ std::string tag::stringify(void) {
 	}
 	output_string += "]:[";
 
-	for (unsigned int i = 0; i < live_dyn_vars.size(); i++) {
-		output_string += std::to_string(live_dyn_vars[i]);
-		if (i != live_dyn_vars.size() - 1) 
-			output_string += ", ";
+	if (live_dyn_vars != nullptr) {
+		for (unsigned int i = 0; i < live_dyn_vars->ids.size(); i++) {
+			output_string += std::to_string(live_dyn_vars->ids[i]);
+			if (i != live_dyn_vars->ids.size() - 1) 
+				output_string += ", ";
+		}
 	}
 	output_string += "]";
 
@@ -2,6 +2,7 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <map>
+#include <mutex>
 #include <unordered_map>
 
 #ifdef RECOVER_VAR_NAMES
@@ -503,7 +504,10 @@ std::string find_variable_name(void *addr) {
 
 namespace utils {
 static std::unordered_map<tracer::tag, std::string> tag_var_name_map;
+// Runs can be extracted from multiple threads
+static std::mutex tag_var_name_mutex;
 std::string find_variable_name_cached(void *addr, tracer::tag stag) {
+	std::lock_guard<std::mutex> lock(tag_var_name_mutex);
 	if (tag_var_name_map.find(stag) != tag_var_name_map.end()) {
 		return tag_var_name_map[stag];
 	}
@@ -0,0 +1,120 @@
+#include "util/work_stealing_pool.h"
+#include <cassert>
+
+namespace utils {
+
+thread_local work_stealing_pool *work_stealing_pool::current_pool = nullptr;
+thread_local int work_stealing_pool::current_worker = -1;
+
+work_stealing_pool::work_stealing_pool(unsigned int num_workers) : pending_tasks(0), stopping(false) {
+	assert(num_workers > 0 && "Pool needs at least one worker");
+	assert(current_pool == nullptr && "Nested work stealing pools are not supported");
+	for (unsigned int i = 0; i < num_workers; i++)
+		queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+
+	// The creating thread is worker 0
+	current_pool = this;
+	current_worker = 0;
+
+	for (unsigned int i = 1; i < num_workers; i++)
+		threads.push_back(std::thread(&work_stealing_pool::worker_loop, this, i));
+}
+
+work_stealing_pool::~work_stealing_pool() {
+	{
+		std::lock_guard<std::mutex> lock(idle_mutex);
+		stopping.store(true);
+	}
+	idle_cv.notify_all();
+	for (auto &t : threads)
+		t.join();
+	current_pool = nullptr;
+	current_worker = -1;
+}
+
+pool_task *work_stealing_pool::pop_local(int index) {
+	worker_queue &q = *queues[index];
+	std::lock_guard<std::mutex> lock(q.queue_mutex);
+	if (q.tasks.empty())
+		return nullptr;
+	pool_task *t = q.tasks.back();
+	q.tasks.pop_back();
+	pending_tasks--;
+	return t;
+}
+
+pool_task *work_stealing_pool::steal(int thief) {
+	int n = queues.size();
+	for (int i = 1; i < n; i++) {
+		worker_queue &q = *queues[(thief + i) % n];
+		std::lock_guard<std::mutex> lock(q.queue_mutex);
+		if (q.tasks.empty())
+			continue;
+		pool_task *t = q.tasks.front();
+		q.tasks.pop_front();
+		pending_tasks--;
+		return t;
+	}
+	return nullptr;
+}
+
+void work_stealing_pool::run_task(pool_task *t) {
+	try {
+		t->func();
+	} catch (...) {
+		t->error = std::current_exception();
+	}
+	t->done.store(true, std::memory_order_release);
+}
+
+void work_stealing_pool::worker_loop(int index) {
+	current_pool = this;
+	current_worker = index;
+	while (1) {
+		pool_task *t = pop_local(index);
+		if (t == nullptr)
+			t = steal(index);
+		if (t != nullptr) {
+			run_task(t);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(idle_mutex);
+		idle_cv.wait(lock, [this] { return stopping.load() || pending_tasks.load() > 0; });
+		if (stopping.load())
+			break;
+	}
+	current_pool = nullptr;
+	current_worker = -1;
+}
+
+void work_stealing_pool::spawn(pool_task *t) {
+	assert(current_pool == this && "Tasks can only be spawned from a worker of the pool");
+	worker_queue &q = *queues[current_worker];
+	{
+		std::lock_guard<std::mutex> lock(q.queue_mutex);
+		q.tasks.push_back(t);
+		pending_tasks++;
+	}
+	{
+		// Take the idle lock so that a worker about to sleep doesn't miss this
+		std::lock_guard<std::mutex> lock(idle_mutex);
+	}
+	idle_cv.notify_one();
+}
+
+void work_stealing_pool::join(pool_task *t) {
+	assert(current_pool == this && "Tasks can only be joined from a worker of the pool");
+	while (!t->is_done()) {
+		pool_task *other = pop_local(current_worker);
+		if (other == nullptr)
+			other = steal(current_worker);
+		if (other != nullptr)
+			run_task(other);
+		else
+			std::this_thread::yield();
+	}
+	if (t->error)
+		std::rethrow_exception(t->error);
+}
+
+} // namespace utils